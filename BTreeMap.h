@@ -0,0 +1,1003 @@
+#ifndef AISDI_MAPS_BTREEMAP_H
+#define AISDI_MAPS_BTREEMAP_H
+
+#include <cstddef>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+#include <tuple>
+#include <functional>
+#include <new>
+
+#include "NodePool.h"
+
+namespace aisdi
+{
+
+/*
+  B+tree variant of TreeMap. Entries are kept in sorted arrays in the
+  leaves, which are linked both ways for iteration; inner nodes hold only
+  separator keys and child pointers. A node takes about nodeBytes, so a
+  lookup reads a few cache lines per level over log_B(n) levels instead of
+  one node per level over about 1.44 log2(n).
+
+  Unlike in TreeMap entries move around: any insert or remove invalidates
+  iterators and references into the map. The key of a value_type is const,
+  so keys are copied when entries shift within a leaf or to a sibling.
+*/
+template <typename KeyType,
+          typename ValueType,
+          typename Compare = std::less<KeyType>>
+class BTreeMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  static const size_type nodeBytes = 512;
+
+  /* entries per leaf and keys per inner node (which has one child more), at least 4 */
+  static const size_type leafSlots =
+    nodeBytes / sizeof(value_type) < 4 ? 4 : nodeBytes / sizeof(value_type);
+  static const size_type innerSlots =
+    nodeBytes / (sizeof(key_type) + sizeof(void*)) < 4 ? 4 : nodeBytes / (sizeof(key_type) + sizeof(void*));
+
+  /* below these counts a node borrows from or merges with a sibling; a split leaves both halves at or above */
+  static const size_type leafMin = leafSlots / 2;
+  static const size_type innerMin = (innerSlots - 1) / 2;
+
+  struct Inner;
+
+  struct Node
+  {
+    Inner *parent;
+    size_type count;
+    bool leaf;
+
+    explicit Node(bool leaf_)
+      :parent(nullptr), count(0), leaf(leaf_) {}
+  };
+
+  /* count entries in slots 0..count-1, the rest of the storage is raw */
+  struct Leaf : Node
+  {
+    Leaf *prev;
+    Leaf *next;
+    alignas(value_type) unsigned char storage[sizeof(value_type) * leafSlots];
+
+    Leaf()
+      :Node(true), prev(nullptr), next(nullptr) {}
+
+    value_type *slot(size_type i)
+    {
+      return reinterpret_cast<value_type*>(storage) + i;
+    }
+
+    const value_type *slot(size_type i) const
+    {
+      return reinterpret_cast<const value_type*>(storage) + i;
+    }
+  };
+
+  /* count keys and count + 1 children; keys of children[i + 1] are not less than key(i) */
+  struct Inner : Node
+  {
+    Node *children[innerSlots + 1];
+    alignas(key_type) unsigned char storage[sizeof(key_type) * innerSlots];
+
+    Inner()
+      :Node(false) {}
+
+    key_type *key(size_type i)
+    {
+      return reinterpret_cast<key_type*>(storage) + i;
+    }
+
+    const key_type *key(size_type i) const
+    {
+      return reinterpret_cast<const key_type*>(storage) + i;
+    }
+  };
+
+  /* nullptr while the map is empty */
+  Node *root;
+  Leaf *firstLeaf;
+  Leaf *lastLeaf;
+
+  size_type Size;
+  size_type leafCount, innerCount;
+
+  Compare comp;
+
+  /* moves *from into the raw slot to and destroys *from */
+  template <typename T>
+  static void relocate(T *to, T *from)
+  {
+    new (to) T(std::move(*from));
+    from->~T();
+  }
+
+  Leaf *newLeaf()
+  {
+    Leaf *l = new Leaf;
+    ++leafCount;
+    return l;
+  }
+
+  Inner *newInner()
+  {
+    Inner *n = new Inner;
+    ++innerCount;
+    return n;
+  }
+
+  void freeLeaf(Leaf *l)
+  {
+    delete l;
+    --leafCount;
+  }
+
+  void freeInner(Inner *n)
+  {
+    delete n;
+    --innerCount;
+  }
+
+  void destroySubtree(Node *t)
+  {
+    if(t->leaf)
+    {
+      Leaf *l = static_cast<Leaf*>(t);
+      for(size_type i = 0; i < l->count; ++i)
+        l->slot(i)->~value_type();
+      freeLeaf(l);
+      return;
+    }
+    Inner *n = static_cast<Inner*>(t);
+    for(size_type i = 0; i <= n->count; ++i)
+      destroySubtree(n->children[i]);
+    for(size_type i = 0; i < n->count; ++i)
+      n->key(i)->~key_type();
+    freeInner(n);
+  }
+
+  /* first slot of l whose key is not less than key */
+  size_type lowerBound(const Leaf *l, const key_type& key) const
+  {
+    size_type lo = 0, hi = l->count;
+    while(lo < hi)
+    {
+      size_type mid = (lo + hi) / 2;
+      if(comp(l->slot(mid)->first, key))
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return lo;
+  }
+
+  /* the child of n key belongs to: the number of separators not greater than key */
+  size_type childIndex(const Inner *n, const key_type& key) const
+  {
+    size_type lo = 0, hi = n->count;
+    while(lo < hi)
+    {
+      size_type mid = (lo + hi) / 2;
+      if(comp(key, *n->key(mid)))
+        hi = mid;
+      else
+        lo = mid + 1;
+    }
+    return lo;
+  }
+
+  /* the leaf key is in or would go to; the map must not be empty */
+  Leaf *findLeaf(const key_type& key) const
+  {
+    Node *t = root;
+    while(!t->leaf)
+    {
+      const Inner *n = static_cast<const Inner*>(t);
+      t = n->children[childIndex(n, key)];
+    }
+    return static_cast<Leaf*>(t);
+  }
+
+  /* leaf holding key and its slot, nullptr if the key is missing */
+  Leaf *findEntry(const key_type& key, size_type &index) const
+  {
+    if(root == nullptr)
+      return nullptr;
+    Leaf *l = findLeaf(key);
+    index = lowerBound(l, key);
+    if(index < l->count && !comp(key, l->slot(index)->first))
+      return l;
+    return nullptr;
+  }
+
+  Leaf *valueLeaf(const key_type& key, size_type &index) const
+  {
+    Leaf *l = findEntry(key, index);
+    if(l == nullptr)
+      throw std::out_of_range("out of range");
+    return l;
+  }
+
+  size_type childPosition(const Inner *parent, const Node *child) const
+  {
+    size_type i = 0;
+    while(parent->children[i] != child)
+      ++i;
+    return i;
+  }
+
+  /* links right in after left below their parent, with separator key; splits full parents upwards */
+  void insertIntoParent(Node *left, const key_type& key, Node *right)
+  {
+    if(left->parent == nullptr)
+    {
+      Inner *n = newInner();
+      new (n->key(0)) key_type(key);
+      n->children[0] = left;
+      n->children[1] = right;
+      n->count = 1;
+      left->parent = right->parent = n;
+      root = n;
+      return;
+    }
+
+    if(left->parent->count == innerSlots)
+      splitInner(left->parent);
+
+    Inner *parent = left->parent;
+    size_type pos = childPosition(parent, left);
+    for(size_type i = parent->count; i > pos; --i)
+    {
+      relocate(parent->key(i), parent->key(i - 1));
+      parent->children[i + 1] = parent->children[i];
+    }
+    new (parent->key(pos)) key_type(key);
+    parent->children[pos + 1] = right;
+    right->parent = parent;
+    ++parent->count;
+  }
+
+  /* moves the upper half of a full inner node to a new sibling, the middle key goes up */
+  void splitInner(Inner *n)
+  {
+    const size_type mid = innerSlots / 2;
+    Inner *right = newInner();
+    for(size_type i = mid + 1; i < innerSlots; ++i)
+      relocate(right->key(i - mid - 1), n->key(i));
+    for(size_type i = mid + 1; i <= innerSlots; ++i)
+    {
+      right->children[i - mid - 1] = n->children[i];
+      n->children[i]->parent = right;
+    }
+    right->count = innerSlots - mid - 1;
+    n->count = mid;
+
+    insertIntoParent(n, *n->key(mid), right);
+    n->key(mid)->~key_type();
+  }
+
+  /*
+    Moves the entries of a full leaf from slot at on to a new right sibling
+    and returns it. Inserts past the last entry of the map do not split but
+    start a new leaf instead, so ascending inserts fill leaves completely.
+  */
+  Leaf *splitLeaf(Leaf *l, size_type at)
+  {
+    Leaf *right = newLeaf();
+    for(size_type i = at; i < l->count; ++i)
+      relocate(right->slot(i - at), l->slot(i));
+    right->count = l->count - at;
+    l->count = at;
+
+    right->next = l->next;
+    right->prev = l;
+    if(l->next != nullptr)
+      l->next->prev = right;
+    else
+      lastLeaf = right;
+    l->next = right;
+    return right;
+  }
+
+  template <typename K, typename... Args>
+  std::pair<iterator, bool> tryEmplaceT(K&& key, Args&&... args)
+  {
+    if(root == nullptr)
+      root = firstLeaf = lastLeaf = newLeaf();
+
+    Leaf *l = findLeaf(key);
+    size_type index = lowerBound(l, key);
+    if(index < l->count && !comp(key, l->slot(index)->first))
+      return std::pair<iterator, bool>(iterator(makeIterator(l, index)), false);
+
+    if(l->count == leafSlots)
+    {
+      if(l == lastLeaf && index == l->count)
+      {
+        Leaf *right = newLeaf();
+        try
+        {
+          new (right->slot(0)) value_type(std::piecewise_construct,
+                                          std::forward_as_tuple(std::forward<K>(key)),
+                                          std::forward_as_tuple(std::forward<Args>(args)...));
+        }
+        catch(...)
+        {
+          freeLeaf(right);
+          throw;
+        }
+        right->count = 1;
+        ++Size;
+        right->prev = l;
+        l->next = right;
+        lastLeaf = right;
+        insertIntoParent(l, right->slot(0)->first, right);
+        return std::pair<iterator, bool>(iterator(makeIterator(right, 0)), true);
+      }
+
+      Leaf *right = splitLeaf(l, leafSlots / 2);
+      insertIntoParent(l, right->slot(0)->first, right);
+      if(index > l->count)
+      {
+        index -= l->count;
+        l = right;
+      }
+    }
+
+    for(size_type i = l->count; i > index; --i)
+      relocate(l->slot(i), l->slot(i - 1));
+    try
+    {
+      new (l->slot(index)) value_type(std::piecewise_construct,
+                                      std::forward_as_tuple(std::forward<K>(key)),
+                                      std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+    catch(...)
+    {
+      for(size_type i = index; i < l->count; ++i)
+        relocate(l->slot(i), l->slot(i + 1));
+      throw;
+    }
+    ++l->count;
+    ++Size;
+    return std::pair<iterator, bool>(iterator(makeIterator(l, index)), true);
+  }
+
+  /* copies item behind the last entry; item must be greater than every key in the map */
+  void append(const value_type& item)
+  {
+    if(root == nullptr)
+      root = firstLeaf = lastLeaf = newLeaf();
+
+    Leaf *l = lastLeaf;
+    if(l->count < leafSlots)
+    {
+      new (l->slot(l->count)) value_type(item);
+      ++l->count;
+      ++Size;
+      return;
+    }
+
+    Leaf *n = newLeaf();
+    try
+    {
+      new (n->slot(0)) value_type(item);
+    }
+    catch(...)
+    {
+      freeLeaf(n);
+      throw;
+    }
+    n->count = 1;
+    ++Size;
+    n->prev = l;
+    l->next = n;
+    lastLeaf = n;
+    insertIntoParent(l, n->slot(0)->first, n);
+  }
+
+  void removeEntry(Leaf *l, size_type index)
+  {
+    l->slot(index)->~value_type();
+    for(size_type i = index + 1; i < l->count; ++i)
+      relocate(l->slot(i - 1), l->slot(i));
+    --l->count;
+    --Size;
+
+    if(l == root)
+    {
+      if(l->count == 0)
+      {
+        freeLeaf(l);
+        root = firstLeaf = lastLeaf = nullptr;
+      }
+      return;
+    }
+    if(l->count < leafMin)
+      fixLeaf(l);
+  }
+
+  /*
+    An underfull leaf evens out with a sibling that can spare entries, or
+    merges with it. Taking half the surplus rather than one entry keeps
+    removals in key order from borrowing again on every call.
+  */
+  void fixLeaf(Leaf *l)
+  {
+    Inner *parent = l->parent;
+    size_type pos = childPosition(parent, l);
+    Leaf *left = pos > 0 ? static_cast<Leaf*>(parent->children[pos - 1]) : nullptr;
+    Leaf *right = pos < parent->count ? static_cast<Leaf*>(parent->children[pos + 1]) : nullptr;
+
+    if(left != nullptr && left->count > leafMin)
+    {
+      size_type moved = (left->count - l->count) / 2;
+      for(size_type i = l->count; i > 0; --i)
+        relocate(l->slot(i - 1 + moved), l->slot(i - 1));
+      for(size_type i = 0; i < moved; ++i)
+        relocate(l->slot(i), left->slot(left->count - moved + i));
+      left->count -= moved;
+      l->count += moved;
+      *parent->key(pos - 1) = l->slot(0)->first;
+      return;
+    }
+    if(right != nullptr && right->count > leafMin)
+    {
+      size_type moved = (right->count - l->count) / 2;
+      for(size_type i = 0; i < moved; ++i)
+        relocate(l->slot(l->count + i), right->slot(i));
+      l->count += moved;
+      for(size_type i = moved; i < right->count; ++i)
+        relocate(right->slot(i - moved), right->slot(i));
+      right->count -= moved;
+      *parent->key(pos) = right->slot(0)->first;
+      return;
+    }
+
+    if(left != nullptr)
+      mergeLeaves(left, l, pos - 1);
+    else
+      mergeLeaves(l, right, pos);
+  }
+
+  /* appends b to a, frees b and drops separator k of their parent */
+  void mergeLeaves(Leaf *a, Leaf *b, size_type k)
+  {
+    for(size_type i = 0; i < b->count; ++i)
+      relocate(a->slot(a->count + i), b->slot(i));
+    a->count += b->count;
+    a->next = b->next;
+    if(b->next != nullptr)
+      b->next->prev = a;
+    else
+      lastLeaf = a;
+
+    Inner *parent = a->parent;
+    freeLeaf(b);
+    removeFromInner(parent, k);
+  }
+
+  /* drops key k and child k + 1 of n, then fixes n if it got underfull */
+  void removeFromInner(Inner *n, size_type k)
+  {
+    n->key(k)->~key_type();
+    for(size_type i = k + 1; i < n->count; ++i)
+    {
+      relocate(n->key(i - 1), n->key(i));
+      n->children[i] = n->children[i + 1];
+    }
+    --n->count;
+
+    if(n == root)
+    {
+      if(n->count == 0)
+      {
+        root = n->children[0];
+        root->parent = nullptr;
+        freeInner(n);
+      }
+      return;
+    }
+    if(n->count < innerMin)
+      fixInner(n);
+  }
+
+  /* as fixLeaf, but keys rotate through the parent's separator */
+  void fixInner(Inner *n)
+  {
+    Inner *parent = n->parent;
+    size_type pos = childPosition(parent, n);
+    Inner *left = pos > 0 ? static_cast<Inner*>(parent->children[pos - 1]) : nullptr;
+    Inner *right = pos < parent->count ? static_cast<Inner*>(parent->children[pos + 1]) : nullptr;
+
+    if(left != nullptr && left->count > innerMin)
+    {
+      n->children[n->count + 1] = n->children[n->count];
+      for(size_type i = n->count; i > 0; --i)
+      {
+        relocate(n->key(i), n->key(i - 1));
+        n->children[i] = n->children[i - 1];
+      }
+      new (n->key(0)) key_type(*parent->key(pos - 1));
+      n->children[0] = left->children[left->count];
+      n->children[0]->parent = n;
+      ++n->count;
+      *parent->key(pos - 1) = *left->key(left->count - 1);
+      left->key(left->count - 1)->~key_type();
+      --left->count;
+      return;
+    }
+    if(right != nullptr && right->count > innerMin)
+    {
+      new (n->key(n->count)) key_type(*parent->key(pos));
+      n->children[n->count + 1] = right->children[0];
+      n->children[n->count + 1]->parent = n;
+      ++n->count;
+      *parent->key(pos) = *right->key(0);
+      right->key(0)->~key_type();
+      for(size_type i = 1; i < right->count; ++i)
+      {
+        relocate(right->key(i - 1), right->key(i));
+        right->children[i - 1] = right->children[i];
+      }
+      right->children[right->count - 1] = right->children[right->count];
+      --right->count;
+      return;
+    }
+
+    if(left != nullptr)
+      mergeInner(left, n, pos - 1);
+    else
+      mergeInner(n, right, pos);
+  }
+
+  /* a gets separator k of the parent, then the keys and children of b */
+  void mergeInner(Inner *a, Inner *b, size_type k)
+  {
+    Inner *parent = a->parent;
+    new (a->key(a->count)) key_type(*parent->key(k));
+    for(size_type i = 0; i < b->count; ++i)
+      relocate(a->key(a->count + 1 + i), b->key(i));
+    for(size_type i = 0; i <= b->count; ++i)
+    {
+      a->children[a->count + 1 + i] = b->children[i];
+      b->children[i]->parent = a;
+    }
+    a->count += b->count + 1;
+    freeInner(b);
+    removeFromInner(parent, k);
+  }
+
+  const_iterator makeIterator(Leaf *l, size_type index) const
+  {
+    ConstIterator it;
+    it.leaf = l;
+    it.index = index;
+    it.ptrMap = this;
+    return it;
+  }
+
+  void copyFrom(const BTreeMap& other)
+  {
+    for(const Leaf *l = other.firstLeaf; l != nullptr; l = l->next)
+    {
+      for(size_type i = 0; i < l->count; ++i)
+        append(*l->slot(i));
+    }
+  }
+
+  void takeFrom(BTreeMap& other)
+  {
+    root = other.root;
+    firstLeaf = other.firstLeaf;
+    lastLeaf = other.lastLeaf;
+    Size = other.Size;
+    leafCount = other.leafCount;
+    innerCount = other.innerCount;
+    other.root = nullptr;
+    other.firstLeaf = other.lastLeaf = nullptr;
+    other.Size = other.leafCount = other.innerCount = 0;
+  }
+
+public:
+
+  BTreeMap()
+    :root(nullptr), firstLeaf(nullptr), lastLeaf(nullptr), Size(0), leafCount(0), innerCount(0)
+  {}
+
+  BTreeMap(std::initializer_list<value_type> list)
+    :BTreeMap()
+  {
+    for(auto it = list.begin(); it != list.end(); ++it)
+      tryEmplaceT(it->first, it->second);
+  }
+
+  /* O(n): the entries come in order, so they are appended to the last leaf */
+  BTreeMap(const BTreeMap& other)
+    :BTreeMap()
+  {
+    comp = other.comp;
+    copyFrom(other);
+  }
+
+  BTreeMap(BTreeMap&& other)
+    :comp(other.comp)
+  {
+    takeFrom(other);
+  }
+
+  ~BTreeMap()
+  {
+    makeEmpty();
+  }
+
+  BTreeMap& operator=(const BTreeMap& other)
+  {
+    if(this == &other)
+      return *this;
+
+    makeEmpty();
+    comp = other.comp;
+    copyFrom(other);
+    return *this;
+  }
+
+  BTreeMap& operator=(BTreeMap&& other)
+  {
+    if(this == &other)
+      return *this;
+
+    makeEmpty();
+    comp = other.comp;
+    takeFrom(other);
+    return *this;
+  }
+
+  void makeEmpty()
+  {
+    if(root != nullptr)
+      destroySubtree(root);
+    root = nullptr;
+    firstLeaf = lastLeaf = nullptr;
+    Size = 0;
+  }
+
+  bool isEmpty() const
+  {
+    return Size == 0;
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args)
+  {
+    return tryEmplaceT(key, std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args)
+  {
+    return tryEmplaceT(std::move(key), std::forward<Args>(args)...);
+  }
+
+  std::pair<iterator, bool> insert(const value_type& item)
+  {
+    return tryEmplaceT(item.first, item.second);
+  }
+
+  std::pair<iterator, bool> insert(value_type&& item)
+  {
+    return tryEmplaceT(item.first, std::move(item.second));
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& obj)
+  {
+    auto result = tryEmplaceT(key, std::forward<M>(obj));
+    if(!result.second)
+      result.first->second = std::forward<M>(obj);
+    return result;
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    return tryEmplaceT(key).first->second;
+  }
+
+  mapped_type& operator[](key_type&& key)
+  {
+    return tryEmplaceT(std::move(key)).first->second;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    size_type index;
+    return valueLeaf(key, index)->slot(index)->second;
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    size_type index;
+    return valueLeaf(key, index)->slot(index)->second;
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    size_type index;
+    Leaf *l = findEntry(key, index);
+    return l == nullptr ? cend() : makeIterator(l, index);
+  }
+
+  iterator find(const key_type& key)
+  {
+    return iterator(static_cast<const BTreeMap*>(this)->find(key));
+  }
+
+  bool contains(const key_type& key) const
+  {
+    size_type index;
+    return findEntry(key, index) != nullptr;
+  }
+
+  void remove(const key_type& key)
+  {
+    size_type index;
+    Leaf *l = findEntry(key, index);
+    if(l == nullptr)
+      throw std::out_of_range("out of range not found");
+    removeEntry(l, index);
+  }
+
+  void remove(const const_iterator& it)
+  {
+    if(it.ptrMap != this || it.leaf == nullptr)
+      throw std::out_of_range("out of range not found");
+    removeEntry(it.leaf, it.index);
+  }
+
+  size_type getSize() const
+  {
+    return Size;
+  }
+
+  /* bytes the map holds, see MemoryUsage; free slots of the nodes count as node bytes */
+  MemoryUsage memory_usage() const
+  {
+    MemoryUsage m;
+    m.objectBytes = sizeof(*this);
+    m.bucketBytes = 0;
+    m.nodeBytes = leafCount * sizeof(Leaf) + innerCount * sizeof(Inner);
+    m.overheadBytes = leafCount * allocationOverhead(sizeof(Leaf))
+                      + innerCount * allocationOverhead(sizeof(Inner));
+    m.payloadBytes = Size * sizeof(value_type);
+    return m;
+  }
+
+  bool operator==(const BTreeMap& other) const
+  {
+    if(Size != other.Size)
+      return false;
+
+    auto b = other.begin();
+    for(auto a = begin(); a != end(); ++a, ++b)
+    {
+      if(*a != *b)
+        return false;
+    }
+    return true;
+  }
+
+  bool operator!=(const BTreeMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  iterator begin()
+  {
+    return iterator(cbegin());
+  }
+
+  iterator end()
+  {
+    return iterator(cend());
+  }
+
+  const_iterator cbegin() const
+  {
+    return Size == 0 ? cend() : makeIterator(firstLeaf, 0);
+  }
+
+  const_iterator cend() const
+  {
+    return makeIterator(nullptr, 0);
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Compare>
+class BTreeMap<KeyType, ValueType, Compare>::ConstIterator
+{
+  friend class BTreeMap;
+
+public:
+  using reference = typename BTreeMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename BTreeMap::value_type;
+  using pointer = const typename BTreeMap::value_type*;
+
+private:
+  /* nullptr for end() */
+  typename BTreeMap::Leaf *leaf;
+  size_type index;
+  const BTreeMap *ptrMap;
+
+public:
+
+  explicit ConstIterator()
+  {
+    leaf = nullptr;
+    index = 0;
+    ptrMap = nullptr;
+  }
+
+  ConstIterator(const ConstIterator& other)
+  {
+    leaf = other.leaf;
+    index = other.index;
+    ptrMap = other.ptrMap;
+  }
+
+  ConstIterator& operator=(const ConstIterator& other) = default;
+
+  ConstIterator& operator++()
+  {
+    if(leaf == nullptr)
+      throw std::out_of_range("out of range (on last)");
+
+    if(++index == leaf->count)
+    {
+      leaf = leaf->next;
+      index = 0;
+    }
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    ConstIterator it = *this;
+    ++(*this);
+    return it;
+  }
+
+  ConstIterator& operator--()
+  {
+    if(leaf == nullptr)
+    {
+      if(ptrMap == nullptr || ptrMap->Size == 0)
+        throw std::out_of_range("out of range (on first)");
+      leaf = ptrMap->lastLeaf;
+      index = leaf->count - 1;
+    }
+    else if(index > 0)
+    {
+      --index;
+    }
+    else
+    {
+      if(leaf->prev == nullptr)
+        throw std::out_of_range("out of range (on first)");
+      leaf = leaf->prev;
+      index = leaf->count - 1;
+    }
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    ConstIterator it = *this;
+    --(*this);
+    return it;
+  }
+
+  reference operator*() const
+  {
+    if(leaf == nullptr)
+      throw std::out_of_range("out of range operator*");
+
+    return *leaf->slot(index);
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return leaf == other.leaf && index == other.index;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Compare>
+class BTreeMap<KeyType, ValueType, Compare>::Iterator : public BTreeMap<KeyType, ValueType, Compare>::ConstIterator
+{
+public:
+  using reference = typename BTreeMap::reference;
+  using pointer = typename BTreeMap::value_type*;
+
+  explicit Iterator()
+  {}
+
+  Iterator(const ConstIterator& other)
+    : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  reference operator*() const
+  {
+    // ugly cast, yet reduces code duplication.
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_BTREEMAP_H */
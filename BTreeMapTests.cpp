@@ -0,0 +1,378 @@
+#include <BTreeMap.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+namespace
+{
+
+class OperationCountingObject
+{
+public:
+  OperationCountingObject(int value_ = 0)
+    : value(value_)
+  {
+    ++constructedObjects;
+  }
+
+  OperationCountingObject(const OperationCountingObject& other)
+    : value(other.value)
+  {
+    ++constructedObjects;
+    ++copiedObjects;
+  }
+
+  OperationCountingObject(OperationCountingObject&& other)
+    : value(other.value)
+  {
+    ++constructedObjects;
+    ++movedObjects;
+  }
+
+  ~OperationCountingObject()
+  {
+    ++destroyedObjects;
+  }
+
+  OperationCountingObject& operator=(const OperationCountingObject& other)
+  {
+    ++assignedObjects;
+    value = other.value;
+    return *this;
+  }
+
+  OperationCountingObject& operator=(OperationCountingObject&& other)
+  {
+    ++assignedObjects;
+    ++movedObjects;
+    value = other.value;
+    return *this;
+  }
+
+  operator int() const
+  {
+    return value;
+  }
+
+  static void resetCounters()
+  {
+    constructedObjects = 0;
+    destroyedObjects = 0;
+    copiedObjects = 0;
+    movedObjects = 0;
+    assignedObjects = 0;
+  }
+
+  static std::size_t constructedObjectsCount()
+  {
+    return constructedObjects;
+  }
+
+  static std::size_t copiedObjectsCount()
+  {
+    return copiedObjects;
+  }
+
+  static std::size_t movedObjectsCount()
+  {
+    return movedObjects;
+  }
+
+private:
+  int value;
+
+  static std::size_t constructedObjects;
+  static std::size_t destroyedObjects;
+  static std::size_t copiedObjects;
+  static std::size_t movedObjects;
+  static std::size_t assignedObjects;
+};
+
+std::size_t OperationCountingObject::constructedObjects = 0;
+std::size_t OperationCountingObject::destroyedObjects = 0;
+std::size_t OperationCountingObject::copiedObjects = 0;
+std::size_t OperationCountingObject::movedObjects = 0;
+std::size_t OperationCountingObject::assignedObjects = 0;
+
+std::ostream& operator<<(std::ostream& out, const OperationCountingObject& obj)
+{
+  return out << '<' << static_cast<int>(obj) << '>';
+}
+
+struct Fixture
+{
+  Fixture()
+  {
+    OperationCountingObject::resetCounters();
+  }
+};
+
+/* a key and value large enough that every node holds only the minimum of 4 */
+struct WideKey
+{
+  int value;
+  char padding[252];
+
+  WideKey(int value_ = 0)
+    : value(value_), padding() {}
+
+  bool operator<(const WideKey& other) const
+  {
+    return value < other.value;
+  }
+};
+
+struct WideValue
+{
+  int value;
+  char padding[252];
+
+  WideValue(int value_ = 0)
+    : value(value_), padding() {}
+};
+
+} // namespace
+
+template <typename K>
+using Map = aisdi::BTreeMap<K, std::string>;
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t, OperationCountingObject>;
+
+BOOST_FIXTURE_TEST_SUITE(BTreeMapTests, Fixture)
+
+template <typename K>
+void thenMapContainsItems(const Map<K>& map,
+                          const std::map<K, std::string>& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  auto it = map.begin();
+  for (const auto& item : expected)
+  {
+    BOOST_REQUIRE_MESSAGE(it != map.end(), "Missing required item with key: " << item.first);
+    BOOST_CHECK_EQUAL(it->first, item.first);
+    BOOST_CHECK_EQUAL(it->second, item.second);
+    ++it;
+  }
+  BOOST_CHECK(it == map.end());
+}
+
+template <typename T>
+void thenCopiedObjectsCountWas(std::size_t count)
+{
+  (void) count;
+  // unable to check it (in a simple way) for all objects, hence template specialization.
+}
+
+template <typename T>
+void thenMovedObjectsCountWas(std::size_t count)
+{
+  (void) count;
+  // unable to check it (in a simple way) for all objects, hence template specialization.
+}
+
+template <>
+void thenCopiedObjectsCountWas<OperationCountingObject>(std::size_t count)
+{
+  BOOST_CHECK_EQUAL(OperationCountingObject::copiedObjectsCount(), count);
+}
+
+template <>
+void thenMovedObjectsCountWas<OperationCountingObject>(std::size_t count)
+{
+  BOOST_CHECK_EQUAL(OperationCountingObject::movedObjectsCount(), count);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenAddingItemsInAnyOrder_ThenTheyAreIteratedInKeyOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+
+  for (int key : { 5, 1, 9, 3, 7, 2, 8 })
+    map[key] = std::to_string(key);
+
+  thenMapContainsItems(map, { { 1, "1" }, { 2, "2" }, { 3, "3" }, { 5, "5" },
+                              { 7, "7" }, { 8, "8" }, { 9, "9" } });
+  BOOST_CHECK_EQUAL(map.valueOf(7), "7");
+  BOOST_CHECK(map.find(4) == map.end());
+  BOOST_CHECK_THROW(map.valueOf(4), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenTryEmplacingOrAssigning_ThenOnlyAssignReplacesValue,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" } };
+
+  auto inserted = map.try_emplace(27, "Bob");
+  auto existing = map.try_emplace(42, "Chuck");
+  BOOST_CHECK(inserted.second);
+  BOOST_CHECK(inserted.first == map.find(27));
+  BOOST_CHECK(!existing.second);
+  BOOST_CHECK_EQUAL(existing.first->second, "Alice");
+
+  BOOST_CHECK(!map.insert_or_assign(42, "Dave").second);
+  BOOST_CHECK(map.insert({ 7, "Eve" }).second);
+  BOOST_CHECK(!map.insert({ 7, "Frank" }).second);
+
+  thenMapContainsItems(map, { { 7, "Eve" }, { 27, "Bob" }, { 42, "Dave" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMissingKey_WhenUsingSubscript_ThenKeyIsCopiedOrMovedOnce,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "x" }, { 2, "y" }, { 3, "z" } };
+  const K key(42);
+  K other(27);
+
+  OperationCountingObject::resetCounters();
+  map[std::move(other)] = "Chuck";
+  map[key] = "Alice";
+  map[key] = "Bob";
+
+  thenCopiedObjectsCountWas<K>(1);
+  thenMovedObjectsCountWas<K>(1);
+  BOOST_CHECK_EQUAL(map.valueOf(42), "Bob");
+  BOOST_CHECK_EQUAL(map.valueOf(27), "Chuck");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyLeaves_WhenIteratingBothWays_ThenItemsComeInKeyOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 1000; ++i)
+  {
+    int key = (i * 7919) % 1000;
+    map[key] = std::to_string(key);
+    expected[key] = std::to_string(key);
+  }
+
+  thenMapContainsItems(map, expected);
+  auto it = map.end();
+  for (auto e = expected.rbegin(); e != expected.rend(); ++e)
+  {
+    --it;
+    BOOST_CHECK_EQUAL(it->first, e->first);
+  }
+  BOOST_CHECK(it == map.begin());
+  BOOST_CHECK_THROW(--it, std::out_of_range);
+  BOOST_CHECK_THROW(++map.end(), std::out_of_range);
+  BOOST_CHECK_THROW(*map.end(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenRemovingEveryItem_ThenMapIsEmptyAndUsable,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int key = 0; key < 300; ++key)
+    map[key] = std::to_string(key);
+
+  for (int key = 0; key < 300; key += 2)
+    map.remove(key);
+  while (!map.isEmpty())
+    map.remove(map.begin());
+
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK_THROW(map.remove(3), std::out_of_range);
+  BOOST_CHECK_THROW(map.remove(map.end()), std::out_of_range);
+  map[5] = "e";
+  map[4] = "d";
+  thenMapContainsItems(map, { { 4, "d" }, { 5, "e" } });
+}
+
+BOOST_AUTO_TEST_CASE(GivenMinimalNodes_WhenMixingOperationsAtRandom_ThenMapMatchesStdMap)
+{
+  aisdi::BTreeMap<WideKey, WideValue> map;
+  std::map<int, int> expected;
+  std::srand(27);
+
+  for (int step = 0; step < 20000; ++step)
+  {
+    int key = std::rand() % 500;
+    switch (std::rand() % 4)
+    {
+    case 0:
+    case 1:
+      map[key] = step;
+      expected[key] = step;
+      break;
+    case 2:
+      if (expected.erase(key))
+        map.remove(key);
+      else
+        BOOST_CHECK_THROW(map.remove(key), std::out_of_range);
+      break;
+    default:
+      BOOST_CHECK_EQUAL(map.contains(key), expected.count(key) == 1);
+    }
+  }
+
+  BOOST_REQUIRE_EQUAL(map.getSize(), expected.size());
+  auto it = map.begin();
+  for (const auto& item : expected)
+  {
+    BOOST_CHECK_EQUAL(it->first.value, item.first);
+    BOOST_CHECK_EQUAL(it->second.value, item.second);
+    ++it;
+  }
+  BOOST_CHECK(it == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCopyingOrMoving_ThenMapsAreEqual,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int key = 0; key < 500; ++key)
+    map[(key * 31) % 500] = std::to_string(key);
+
+  Map<K> copy(map);
+  BOOST_CHECK(copy == map);
+  copy[1000] = "x";
+  BOOST_CHECK(copy != map);
+
+  Map<K> moved(std::move(copy));
+  BOOST_CHECK(copy.isEmpty());
+  BOOST_CHECK_EQUAL(moved.getSize(), 501);
+
+  moved = map;
+  BOOST_CHECK(moved == map);
+  copy = std::move(moved);
+  BOOST_CHECK(copy == map);
+  copy.remove(250);
+  BOOST_CHECK_EQUAL(copy.getSize(), 499);
+}
+
+BOOST_AUTO_TEST_CASE(GivenAscendingKeys_WhenInserting_ThenLeavesAreFilledCompletely)
+{
+  aisdi::BTreeMap<int, int> ascending;
+  aisdi::BTreeMap<int, int> scattered;
+  for (int i = 0; i < 10000; ++i)
+  {
+    ascending[i] = i;
+    scattered[(i * 7919) % 10000] = i;
+  }
+
+  aisdi::MemoryUsage full = ascending.memory_usage();
+  aisdi::MemoryUsage halves = scattered.memory_usage();
+  BOOST_CHECK_EQUAL(full.payloadBytes, halves.payloadBytes);
+  BOOST_CHECK(full.nodeBytes < full.payloadBytes * 12 / 10);
+  BOOST_CHECK(halves.nodeBytes > full.nodeBytes);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,152 @@
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+
+#include "HashMap.h"
+#include "ConcurrentHashMap.h"
+#include "LockFreeHashMap.h"
+
+#include <iostream>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+using us = std::chrono::microseconds;
+using get_time = std::chrono::steady_clock;
+using size_type = std::size_t;
+
+/* keeps the optimizer from dropping lookups whose result is unused */
+volatile size_type sink;
+
+/* the setup this replaces: one HashMap behind one mutex */
+class GlobalLockMap
+{
+  mutable std::mutex lock;
+  aisdi::HashMap<size_type, size_type> map;
+
+public:
+  explicit GlobalLockMap(size_type hashSize)
+    :map(hashSize) {}
+
+  bool find(size_type key) const
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    return map.contains(key);
+  }
+
+  void insert(size_type key, size_type value)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    map.insert_or_assign(key, value);
+  }
+};
+
+class ShardedMap
+{
+  aisdi::ConcurrentHashMap<size_type, size_type> map;
+
+public:
+  explicit ShardedMap(size_type hashSize)
+    :map(hashSize, 64) {}
+
+  bool find(size_type key) const
+  {
+    return map.contains(key);
+  }
+
+  void insert(size_type key, size_type value)
+  {
+    map.insert_or_assign(key, value);
+  }
+};
+
+class LockFreeMap
+{
+  aisdi::LockFreeHashMap<size_type, size_type> map;
+
+public:
+  explicit LockFreeMap(size_type hashSize)
+    :map(hashSize) {}
+
+  bool find(size_type key) const
+  {
+    return map.contains(key);
+  }
+
+  /* entries are immutable, an update is a remove and an insert */
+  void insert(size_type key, size_type value)
+  {
+    if(!map.insert(key, value))
+    {
+      map.remove(key);
+      map.insert(key, value);
+    }
+  }
+};
+
+/* every thread does the same number of operations, one in writeEvery is a write */
+template <typename Map>
+us testMixedLoad(size_type number_of_elements, size_type threads, size_type operations, size_type writeEvery)
+{
+  Map map(number_of_elements);
+  for(size_type i = 0; i < number_of_elements; ++i)
+    map.insert(i, i);
+
+  std::vector<std::thread> workers;
+  auto start = get_time::now();
+
+  for(size_type t = 0; t < threads; ++t)
+  {
+    workers.emplace_back([&map, t, operations, number_of_elements, writeEvery]() {
+      size_type hits = 0;
+      size_type key = t * 7919;
+      for(size_type i = 0; i < operations; ++i)
+      {
+        key = (key * 2862933555777941757ull + 3037000493ull) % (2 * number_of_elements);
+        if(i % writeEvery == 0)
+          map.insert(key % number_of_elements, i);
+        else if(map.find(key))
+          ++hits;
+      }
+      sink = hits;
+    });
+  }
+  for(auto& worker : workers)
+    worker.join();
+
+  return std::chrono::duration_cast<us>(get_time::now() - start);
+}
+
+void report(const char* name, size_type threads, us time)
+{
+  std::cout << name << " (" << threads << " threads): " << time.count() << " us\n";
+}
+
+int main(int argc, char** argv)
+{
+  const size_type repeatCount = argc > 1 ? std::atoll(argv[1]) : 60000;
+  const size_type maxThreads = argc > 2 ? std::atoll(argv[2]) : 32;
+  const size_type operations = 200000;
+
+  std::cout << "Mixed lookups and updates (10% writes), " << operations << " operations per thread\n";
+  for(size_type threads = 1; threads <= maxThreads; threads *= 2)
+  {
+    report("Global mutex", threads, testMixedLoad<GlobalLockMap>( repeatCount, threads, operations, 10 ));
+    report("Sharded", threads, testMixedLoad<ShardedMap>( repeatCount, threads, operations, 10 ));
+    report("Lock-free", threads, testMixedLoad<LockFreeMap>( repeatCount, threads, operations, 10 ));
+    std::cout << "\n";
+  }
+
+  std::cout << "Read-mostly (1% writes), " << operations << " operations per thread\n";
+  for(size_type threads = 1; threads <= maxThreads; threads *= 2)
+  {
+    report("Global mutex", threads, testMixedLoad<GlobalLockMap>( repeatCount, threads, operations, 100 ));
+    report("Sharded", threads, testMixedLoad<ShardedMap>( repeatCount, threads, operations, 100 ));
+    report("Lock-free", threads, testMixedLoad<LockFreeMap>( repeatCount, threads, operations, 100 ));
+    std::cout << "\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,238 @@
+#ifndef AISDI_MAPS_CONCURRENTHASHMAP_H
+#define AISDI_MAPS_CONCURRENTHASHMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <functional>
+#include <optional>
+#include <mutex>
+#include <shared_mutex>
+
+#include "HashMap.h"
+
+namespace aisdi
+{
+
+/*
+  Thread-safe map made of independent HashMap shards, each behind its own
+  reader-writer lock. A key always goes to the same shard, so operations on
+  keys of different shards never wait for each other and lookups of the
+  same shard run in parallel.
+
+  No references or iterators escape a lock: find() returns a copy of the
+  value and update() runs the given function while the shard is held.
+*/
+template <typename KeyType,
+          typename ValueType,
+          typename Hasher = std::hash<KeyType>,
+          typename KeyEqual = std::equal_to<KeyType>,
+          typename NodePolicy = HeapNodes>
+class ConcurrentHashMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using map_type = HashMap<KeyType, ValueType, Hasher, KeyEqual, NodePolicy>;
+
+private:
+  /* one cache line per shard, so taking one lock does not invalidate its neighbours */
+  struct alignas(64) Shard
+  {
+    mutable std::shared_mutex lock;
+    map_type map;
+
+    Shard(size_type hashSize, const Hasher& hash, const KeyEqual& keyEqual)
+      :map(hashSize, hash, keyEqual) {}
+  };
+
+  Shard **shards;
+  size_type nrShards;
+  unsigned shardShift;
+  Hasher hasher;
+  static const size_type defaultSize = 10000;
+  static const size_type defaultShards = 16;
+
+  /*
+    The shard maps reduce the hash by its low bits, so the shard is taken
+    from the top bits of a Fibonacci-multiplied hash. Otherwise every key
+    of a shard would share its low bits and use a fraction of the buckets.
+  */
+  size_type shardIndex(const key_type& key) const
+  {
+    if(nrShards == 1)
+      return 0;
+    std::uint64_t x = static_cast<std::uint64_t>(hasher(key)) * 0x9e3779b97f4a7c15ull;
+    return static_cast<size_type>(x >> shardShift);
+  }
+
+  Shard& shardFor(const key_type& key) const
+  {
+    return *shards[shardIndex(key)];
+  }
+
+public:
+  ConcurrentHashMap()
+    :ConcurrentHashMap(defaultSize)
+  {}
+
+  /* hashSize is split evenly between the shards, shardCount is rounded up to a power of two */
+  explicit ConcurrentHashMap(size_type hashSize,
+                             size_type shardCount = defaultShards,
+                             const Hasher& hash = Hasher(),
+                             const KeyEqual& keyEqual = KeyEqual())
+    :hasher(hash)
+  {
+    if(shardCount == 0)
+      throw std::out_of_range("out of range, shard count must be positive");
+
+    nrShards = 1;
+    shardShift = 64;
+    while(nrShards < shardCount)
+    {
+      nrShards <<= 1;
+      --shardShift;
+    }
+
+    size_type shardSize = hashSize / nrShards + 1;
+    shards = new Shard*[nrShards];
+    size_type built = 0;
+    try
+    {
+      for(; built < nrShards; ++built)
+        shards[built] = new Shard(shardSize, hash, keyEqual);
+    }
+    catch(...)
+    {
+      while(built > 0)
+        delete shards[--built];
+      delete[] shards;
+      throw;
+    }
+  }
+
+  ~ConcurrentHashMap()
+  {
+    for(size_type i = 0; i < nrShards; ++i)
+      delete shards[i];
+    delete[] shards;
+  }
+
+  ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+  ConcurrentHashMap& operator=(const ConcurrentHashMap&) = delete;
+
+  size_type shard_count() const
+  {
+    return nrShards;
+  }
+
+  /* copy of the value, empty if the key is absent */
+  std::optional<mapped_type> find(const key_type& key) const
+  {
+    Shard& shard = shardFor(key);
+    std::shared_lock<std::shared_mutex> guard(shard.lock);
+    auto it = shard.map.find(key);
+    if(it == shard.map.end())
+      return std::nullopt;
+    return it->second;
+  }
+
+  bool contains(const key_type& key) const
+  {
+    Shard& shard = shardFor(key);
+    std::shared_lock<std::shared_mutex> guard(shard.lock);
+    return shard.map.contains(key);
+  }
+
+  /* false and no change if the key is already present */
+  bool insert(const key_type& key, const mapped_type& value)
+  {
+    Shard& shard = shardFor(key);
+    std::unique_lock<std::shared_mutex> guard(shard.lock);
+    return shard.map.try_emplace(key, value).second;
+  }
+
+  bool insert(const value_type& item)
+  {
+    return insert(item.first, item.second);
+  }
+
+  /* true if a new entry was created, false if an existing one was overwritten */
+  bool insert_or_assign(const key_type& key, const mapped_type& value)
+  {
+    Shard& shard = shardFor(key);
+    std::unique_lock<std::shared_mutex> guard(shard.lock);
+    return shard.map.insert_or_assign(key, value).second;
+  }
+
+  /* false if there was no such key */
+  bool erase(const key_type& key)
+  {
+    Shard& shard = shardFor(key);
+    std::unique_lock<std::shared_mutex> guard(shard.lock);
+    auto it = shard.map.find(key);
+    if(it == shard.map.end())
+      return false;
+    shard.map.erase(it);
+    return true;
+  }
+
+  /*
+    Calls fn(mapped_type&) on the value of key with its shard locked for
+    writing, so read-modify-write sequences are atomic. fn must not call
+    back into this map. Returns false without calling fn if key is absent.
+  */
+  template <typename Function>
+  bool update(const key_type& key, Function&& fn)
+  {
+    Shard& shard = shardFor(key);
+    std::unique_lock<std::shared_mutex> guard(shard.lock);
+    auto it = shard.map.find(key);
+    if(it == shard.map.end())
+      return false;
+    fn(it->second);
+    return true;
+  }
+
+  /* like update(), but a missing key is first inserted with a default-constructed value */
+  template <typename Function>
+  void upsert(const key_type& key, Function&& fn)
+  {
+    Shard& shard = shardFor(key);
+    std::unique_lock<std::shared_mutex> guard(shard.lock);
+    fn(shard.map.try_emplace(key).first->second);
+  }
+
+  /* shards are counted one after another, concurrent writers make it a snapshot only */
+  size_type getSize() const
+  {
+    size_type total = 0;
+    for(size_type i = 0; i < nrShards; ++i)
+    {
+      std::shared_lock<std::shared_mutex> guard(shards[i]->lock);
+      total += shards[i]->map.getSize();
+    }
+    return total;
+  }
+
+  bool isEmpty() const
+  {
+    return getSize() == 0;
+  }
+
+  void makeEmpty()
+  {
+    for(size_type i = 0; i < nrShards; ++i)
+    {
+      std::unique_lock<std::shared_mutex> guard(shards[i]->lock);
+      shards[i]->map.makeEmpty();
+    }
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_CONCURRENTHASHMAP_H */
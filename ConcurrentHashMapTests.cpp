@@ -0,0 +1,171 @@
+#include <ConcurrentHashMap.h>
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+
+using Map = aisdi::ConcurrentHashMap<int, std::string>;
+using CounterMap = aisdi::ConcurrentHashMap<int, std::size_t>;
+
+template <typename Function>
+void runThreads(int count, Function fn)
+{
+  std::vector<std::thread> threads;
+  for (int t = 0; t < count; ++t)
+    threads.emplace_back(fn, t);
+  for (auto& thread : threads)
+    thread.join();
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ConcurrentHashMapTests)
+
+BOOST_AUTO_TEST_CASE(GivenEmptyMap_WhenSearchingForKey_ThenNothingIsFound)
+{
+  const Map map;
+
+  BOOST_CHECK(!map.find(42));
+  BOOST_CHECK(!map.contains(42));
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK_EQUAL(map.shard_count(), 16);
+}
+
+BOOST_AUTO_TEST_CASE(GivenShardCount_WhenConstructing_ThenItIsRoundedUpToPowerOfTwo)
+{
+  BOOST_CHECK_EQUAL(Map(100, 1).shard_count(), 1);
+  BOOST_CHECK_EQUAL(Map(100, 5).shard_count(), 8);
+  BOOST_CHECK_THROW(Map(100, 0), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenInsertingItems_ThenExistingKeysAreNotOverwritten)
+{
+  Map map;
+
+  BOOST_CHECK(map.insert(1, "Alice"));
+  BOOST_CHECK(map.insert({ 2, "Bob" }));
+  BOOST_CHECK(!map.insert(1, "Chuck"));
+
+  BOOST_CHECK_EQUAL(*map.find(1), "Alice");
+  BOOST_CHECK_EQUAL(*map.find(2), "Bob");
+  BOOST_CHECK_EQUAL(map.getSize(), 2);
+
+  BOOST_CHECK(!map.insert_or_assign(1, "Dave"));
+  BOOST_CHECK(map.insert_or_assign(3, "Eve"));
+  BOOST_CHECK_EQUAL(*map.find(1), "Dave");
+  BOOST_CHECK_EQUAL(map.getSize(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenErasing_ThenOnlyPresentKeysReportRemoval)
+{
+  Map map;
+  map.insert(1, "Alice");
+
+  BOOST_CHECK(!map.erase(2));
+  BOOST_CHECK(map.erase(1));
+  BOOST_CHECK(!map.erase(1));
+  BOOST_CHECK(map.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenUpdating_ThenOnlyPresentKeysAreChanged)
+{
+  Map map;
+  map.insert(1, "Alice");
+
+  BOOST_CHECK(map.update(1, [](std::string& value) { value += "!"; }));
+  BOOST_CHECK(!map.update(2, [](std::string&) { BOOST_FAIL("called for missing key"); }));
+  map.upsert(2, [](std::string& value) { value = "Bob"; });
+
+  BOOST_CHECK_EQUAL(*map.find(1), "Alice!");
+  BOOST_CHECK_EQUAL(*map.find(2), "Bob");
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenMakingEmpty_ThenAllShardsAreCleared)
+{
+  Map map;
+  for (int i = 0; i < 1000; ++i)
+    map.insert(i, "x");
+
+  map.makeEmpty();
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(!map.contains(7));
+}
+
+BOOST_AUTO_TEST_CASE(GivenManyThreads_WhenInsertingDisjointKeys_ThenAllItemsAreInMap)
+{
+  const int threads = 8;
+  const int perThread = 5000;
+  Map map(100, 8);
+
+  std::atomic<int> rejected(0);
+
+  runThreads(threads, [&](int t) {
+    for (int i = 0; i < perThread; ++i)
+    {
+      if (!map.insert(t * perThread + i, std::to_string(i)))
+        ++rejected;
+    }
+  });
+
+  BOOST_CHECK_EQUAL(rejected.load(), 0);
+  BOOST_CHECK_EQUAL(map.getSize(), threads * perThread);
+  for (int k = 0; k < threads * perThread; ++k)
+    BOOST_REQUIRE_EQUAL(*map.find(k), std::to_string(k % perThread));
+}
+
+BOOST_AUTO_TEST_CASE(GivenManyThreads_WhenUpdatingSharedCounters_ThenNoIncrementIsLost)
+{
+  const int threads = 8;
+  const int rounds = 20000;
+  const int keys = 37;
+  CounterMap map(keys, 4);
+
+  runThreads(threads, [&](int t) {
+    for (int i = 0; i < rounds; ++i)
+      map.upsert((i + t) % keys, [](std::size_t& value) { ++value; });
+  });
+
+  std::size_t total = 0;
+  for (int k = 0; k < keys; ++k)
+    total += *map.find(k);
+  BOOST_CHECK_EQUAL(total, std::size_t(threads) * rounds);
+}
+
+BOOST_AUTO_TEST_CASE(GivenReadersAndWriters_WhenRunningTogether_ThenReadersSeeWholeValues)
+{
+  const int rounds = 20000;
+  Map map(64, 4);
+  for (int k = 0; k < 64; ++k)
+    map.insert(k, "aaaa");
+  std::atomic<int> torn(0);
+
+  runThreads(4, [&](int t) {
+    for (int i = 0; i < rounds; ++i)
+    {
+      int key = (i * 7 + t) % 64;
+      if (t % 2 == 0)
+      {
+        map.insert_or_assign(key, i % 2 ? "aaaa" : "bbbb");
+      }
+      else
+      {
+        auto value = map.find(key);
+        if (!value || (*value != "aaaa" && *value != "bbbb"))
+          ++torn;
+      }
+    }
+  });
+
+  BOOST_CHECK_EQUAL(torn.load(), 0);
+  BOOST_CHECK_EQUAL(map.getSize(), 64);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
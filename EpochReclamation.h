@@ -0,0 +1,241 @@
+#ifndef AISDI_MAPS_EPOCHRECLAMATION_H
+#define AISDI_MAPS_EPOCHRECLAMATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace aisdi
+{
+
+/*
+  Epoch-based reclamation for lock-free structures. A reader pins the
+  current global epoch (EpochGuard) for as long as it holds pointers into
+  the structure. Unlinked objects are retired with the epoch seen when
+  they were retired and freed only once the global epoch is two ahead:
+  the epoch advances only when every pinned thread has caught up with it,
+  so by then no thread can still reach them.
+
+  There is one domain per process. Every thread that pins takes one of
+  maxThreads slots for its lifetime; garbage it leaves behind at exit is
+  handed to the domain and freed by the threads that remain.
+*/
+class EpochDomain
+{
+public:
+  static const std::size_t maxThreads = 256;
+
+  using Deleter = void (*)(void*);
+
+private:
+  struct Retired
+  {
+    void *object;
+    Deleter deleter;
+  };
+
+  /* 0 - not pinned, otherwise (epoch << 1) | 1 */
+  struct alignas(64) Slot
+  {
+    std::atomic<std::uint64_t> state;
+    std::atomic<bool> inUse;
+  };
+
+  /* garbage is sorted by epoch modulo 3; an older list can always be freed before reuse */
+  struct ThreadRecord
+  {
+    Slot *slot;
+    unsigned nesting;
+    std::size_t sinceAdvance;
+    std::vector<Retired> limbo[3];
+    std::uint64_t limboEpoch[3];
+
+    ThreadRecord()
+      :slot(instance().claimSlot()), nesting(0), sinceAdvance(0), limboEpoch{0, 0, 0} {}
+
+    ~ThreadRecord()
+    {
+      instance().releaseSlot(*this);
+    }
+  };
+
+  static const std::size_t advanceEvery = 64;
+
+  alignas(64) std::atomic<std::uint64_t> globalEpoch;
+  Slot slots[maxThreads];
+  std::mutex orphanLock;
+  std::vector<Retired> orphans;
+  std::uint64_t orphanEpoch;
+
+  EpochDomain()
+    :globalEpoch(2), orphanEpoch(0)
+  {
+    for(std::size_t i = 0; i < maxThreads; ++i)
+    {
+      slots[i].state.store(0, std::memory_order_relaxed);
+      slots[i].inUse.store(false, std::memory_order_relaxed);
+    }
+  }
+
+  ~EpochDomain()
+  {
+    freeAll(orphans);
+  }
+
+  static void freeAll(std::vector<Retired>& list)
+  {
+    for(auto& r : list)
+      r.deleter(r.object);
+    list.clear();
+  }
+
+  Slot *claimSlot()
+  {
+    for(std::size_t i = 0; i < maxThreads; ++i)
+    {
+      bool expected = false;
+      if(!slots[i].inUse.load(std::memory_order_relaxed)
+         && slots[i].inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+        return &slots[i];
+    }
+    throw std::length_error("too many threads in the epoch domain");
+  }
+
+  void releaseSlot(ThreadRecord& rec)
+  {
+    {
+      std::lock_guard<std::mutex> guard(orphanLock);
+      std::uint64_t newest = orphanEpoch;
+      for(std::size_t i = 0; i < 3; ++i)
+      {
+        if(rec.limbo[i].empty())
+          continue;
+        orphans.insert(orphans.end(), rec.limbo[i].begin(), rec.limbo[i].end());
+        if(rec.limboEpoch[i] > newest)
+          newest = rec.limboEpoch[i];
+      }
+      orphanEpoch = newest;
+    }
+    rec.slot->state.store(0, std::memory_order_release);
+    rec.slot->inUse.store(false, std::memory_order_release);
+  }
+
+  static ThreadRecord& record()
+  {
+    static thread_local ThreadRecord rec;
+    return rec;
+  }
+
+  /* moves the epoch on if every pinned thread is in the current one */
+  std::uint64_t tryAdvance()
+  {
+    /* pairs with the fence in pin(): the scan sees a thread that pinned before our unlinks became visible */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::uint64_t epoch = globalEpoch.load(std::memory_order_seq_cst);
+    for(std::size_t i = 0; i < maxThreads; ++i)
+    {
+      if(!slots[i].inUse.load(std::memory_order_acquire))
+        continue;
+      std::uint64_t state = slots[i].state.load(std::memory_order_acquire);
+      if((state & 1) && (state >> 1) != epoch)
+        return epoch;
+    }
+    if(globalEpoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel))
+      return epoch + 1;
+    return epoch;
+  }
+
+  void collect(ThreadRecord& rec, std::uint64_t epoch)
+  {
+    for(std::size_t i = 0; i < 3; ++i)
+    {
+      if(!rec.limbo[i].empty() && rec.limboEpoch[i] + 2 <= epoch)
+        freeAll(rec.limbo[i]);
+    }
+
+    std::unique_lock<std::mutex> guard(orphanLock, std::try_to_lock);
+    if(guard.owns_lock() && !orphans.empty() && orphanEpoch + 2 <= epoch)
+      freeAll(orphans);
+  }
+
+public:
+  EpochDomain(const EpochDomain&) = delete;
+  EpochDomain& operator=(const EpochDomain&) = delete;
+
+  static EpochDomain& instance()
+  {
+    static EpochDomain domain;
+    return domain;
+  }
+
+  void pin()
+  {
+    ThreadRecord& rec = record();
+    if(rec.nesting++ != 0)
+      return;
+    std::uint64_t epoch = globalEpoch.load(std::memory_order_seq_cst);
+    rec.slot->state.store((epoch << 1) | 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  void unpin()
+  {
+    ThreadRecord& rec = record();
+    if(--rec.nesting == 0)
+      rec.slot->state.store(0, std::memory_order_release);
+  }
+
+  /* object must already be unreachable for threads that pin from now on */
+  void retire(void *object, Deleter deleter)
+  {
+    ThreadRecord& rec = record();
+    std::uint64_t epoch = globalEpoch.load(std::memory_order_seq_cst);
+    std::vector<Retired>& list = rec.limbo[epoch % 3];
+    if(rec.limboEpoch[epoch % 3] != epoch)
+    {
+      /* that list is from epoch - 3 or older */
+      freeAll(list);
+      rec.limboEpoch[epoch % 3] = epoch;
+    }
+    list.push_back(Retired{ object, deleter });
+
+    if(++rec.sinceAdvance >= advanceEvery)
+    {
+      rec.sinceAdvance = 0;
+      collect(rec, tryAdvance());
+    }
+  }
+
+  /* pushes the epoch forward and frees whatever this thread may; for quiescent points and tests */
+  void flush()
+  {
+    ThreadRecord& rec = record();
+    for(int i = 0; i < 3; ++i)
+      collect(rec, tryAdvance());
+  }
+};
+
+/* keeps the calling thread pinned for its scope; guards nest */
+class EpochGuard
+{
+public:
+  EpochGuard()
+  {
+    EpochDomain::instance().pin();
+  }
+
+  ~EpochGuard()
+  {
+    EpochDomain::instance().unpin();
+  }
+
+  EpochGuard(const EpochGuard&) = delete;
+  EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+}
+
+#endif /* AISDI_MAPS_EPOCHRECLAMATION_H */
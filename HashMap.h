@@ -2,18 +2,71 @@
 #define AISDI_MAPS_HASHMAP_H
 
 #include <cstddef>
+#include <cstdint>
 #include <initializer_list>
 #include <stdexcept>
 #include <utility>
+#include <tuple>
 #include <string>
-//#include <vector>
-#include <sstream>
+#include <vector>
 #include <functional>
+#include <type_traits>
+#include <new>
+
+#include "NodePool.h"
+#include "TransparentLookup.h"
+#include "Instrumentation.h"
 
 namespace aisdi
 {
 
-template <typename KeyType, typename ValueType>
+/*
+  std::hash of integers is the identity. That is fine for the power-of-two
+  reduction as long as keys are sequential, but strided keys (multiples of
+  the bucket count) end up in one chain. MixHash scrambles all bits of the
+  std::hash result (murmur3 finalizer) and can be passed as Hasher.
+*/
+template <typename KeyType>
+struct MixHash
+{
+  std::size_t operator()(const KeyType& key) const
+  {
+    std::uint64_t x = std::hash<KeyType>{}(key);
+    x = (x ^ (x >> 33)) * 0xff51afd7ed558ccdull;
+    x = (x ^ (x >> 33)) * 0xc4ceb9fe1a85ec53ull;
+    x = x ^ (x >> 33);
+    return static_cast<std::size_t>(x);
+  }
+};
+
+/*
+  Snapshot of the chain lengths of a HashMap, see HashMap::stats(). Mean
+  and p99 are taken over non-empty buckets, i.e. they describe the chain
+  a successful lookup walks; chainHistogram[n] is the number of buckets
+  holding n entries.
+*/
+struct HashMapStats
+{
+  std::size_t size;
+  std::size_t bucketCount;
+  float loadFactor;
+  std::size_t maxChain;
+  double meanChain;
+  std::size_t p99Chain;
+  double emptyBucketRatio;
+  std::vector<std::size_t> chainHistogram;
+};
+
+/* node-level access for the coroutine lookups of InterleavedLookup.h */
+template <typename Map>
+struct LookupAccess;
+
+template <typename KeyType,
+          typename ValueType,
+          typename Hasher = std::hash<KeyType>,
+          typename KeyEqual = std::equal_to<KeyType>,
+          typename NodePolicy = HeapNodes,
+          typename Instrumentation = NoInstrumentation>
 class HashMap
 {
 public:
@@ -39,224 +92,1167 @@ private:
     Node()
       :next(nullptr), prev(nullptr){}
 
-    Node(const value_type arg)
-      :data(arg) {}
+    struct InPlace {};
+
+    template <typename... Args>
+    Node(InPlace, Args&&... args)
+      :data(std::forward<Args>(args)...) {}
   };
+  /* nullptr until the map outgrows its inline slots; Size is the bucket count the table gets then */
   Node **head;
-  Node *last;
   size_type Size, nrElem;
   size_type * bucketSize;
-  const size_type defaultSize = 10000;
-
-public:
+  /* the bucket table is allocated lazily, so a default map can start small and double */
+  static const size_type defaultSize = 16;
+  Hasher hasher;
+  KeyEqual equal;
+
+  using NodePool = typename NodePolicy::template Pool<Node>;
+  NodePool pool;
+
+  friend struct LookupAccess<HashMap>;
+
+  /* counters may change in const lookups */
+  mutable Instrumentation instr;
+
+  /* with a slab pool and trivially destructible entries clearing skips the chains altogether */
+  static const bool skipNodeWalk =
+    NodePool::bulkRelease && std::is_trivially_destructible<value_type>::value;
+
+  /*
+    Incremental rehash: while oldHead != nullptr the map grows into head and
+    the old table is drained a few buckets (rehashStep) per mutating call.
+    Buckets of the old table below rehashIndex are already migrated.
+    Buckets of both tables are numbered together: old ones first
+    (0..oldSize-1), then the new ones, which is also the iteration order.
+  */
+  Node **oldHead;
+  size_type *oldBucketSize;
+  size_type oldSize, rehashIndex;
+  float maxLoad;
+  static const size_type rehashStep = 4;
+
+  /*
+    One bit per bucket, set while the chain is non-empty, so iteration jumps
+    between occupied buckets a 64-bucket word at a time. firstBucket is a
+    lower bound of the first occupied position, tightened by cbegin().
+  */
+  std::uint64_t *occupied;
+  std::uint64_t *oldOccupied;
+  mutable size_type firstBucket;
+  static const size_type wordBits = 64;
+
+  /*
+    Small mode (head == nullptr): up to smallCapacity entries are kept in
+    nodes listed in an inline array, which lookups scan linearly comparing
+    the cached hash codes first. A slot keeps its entry until the entry is
+    removed, and a slot is the entry's position, so iterators behave as
+    with buckets. The map moves to the bucket table when it outgrows the
+    slots or the load factor of the planned table.
+  */
+  static const size_type smallCapacity = 8;
+  Node *small[smallCapacity];
+  size_type smallCode[smallCapacity];
+
+  static size_type bitmapWords(size_type buckets)
+  {
+    return (buckets + wordBits - 1) / wordBits;
+  }
 
-  size_type Hash(const key_type key) const
+  static int lowestBit(std::uint64_t word)
   {
-    size_type x = std::hash<size_type>{}(key);
-    return x % Size;
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int i = 0;
+    while(!(word & 1u))
+    {
+      word >>= 1;
+      ++i;
+    }
+    return i;
+#endif
+  }
 
+  static int highestBit(std::uint64_t word)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(word);
+#else
+    int i = 63;
+    while(!(word >> 63))
+    {
+      word <<= 1;
+      --i;
+    }
+    return i;
+#endif
+  }
 
-/*   other hash functions
-    key_type x = key;
-    x = ((x >> 16) ^ x) * 0x45d9f3b;
-    x = ((x >> 16) ^ x) * 0x45d9f3b;
-    x = (x >> 16) ^ x;
-    return x%Size;
+  static void setBit(std::uint64_t *bits, size_type i)
+  {
+    bits[i / wordBits] |= std::uint64_t(1) << (i % wordBits);
+  }
 
+  static void clearBit(std::uint64_t *bits, size_type i)
+  {
+    bits[i / wordBits] &= ~(std::uint64_t(1) << (i % wordBits));
+  }
 
-    std::hash <key_type> convert;
-    size_type x = convert(key);
-    return x%Size;
+  /* first set bit at index >= from, count if there is none */
+  static size_type nextSet(const std::uint64_t *bits, size_type from, size_type count)
+  {
+    if(from >= count)
+      return count;
 
-    long x = 184432;
-    std::stringstream convert;
-    convert << key;
-    std::string tmp = convert.str();
+    size_type w = from / wordBits;
+    std::uint64_t word = bits[w] & (~std::uint64_t(0) << (from % wordBits));
+    while(word == 0)
+    {
+      if(++w == bitmapWords(count))
+        return count;
+      word = bits[w];
+    }
+    return w * wordBits + lowestBit(word);
+  }
 
-    for(size_type i=0; i<tmp.length(); ++i)
+  /* moves pos to the last set bit below it, false if there is none */
+  static bool prevSet(const std::uint64_t *bits, size_type &pos)
+  {
+    while(pos > 0)
     {
-      x = (x<<6)^(x>>26)^tmp[i];
+      size_type w = (pos - 1) / wordBits;
+      std::uint64_t word = bits[w] & (~std::uint64_t(0) >> (wordBits - 1 - (pos - 1) % wordBits));
+      if(word != 0)
+      {
+        pos = w * wordBits + highestBit(word);
+        return true;
+      }
+      pos = w * wordBits;
     }
-    return x % Size;
-    */
+    return false;
   }
 
-  void makeEmpty()
+  size_type positions() const
   {
-    nrElem = 0;
+    return head == nullptr ? smallCapacity : oldSize + Size;
+  }
+
+  Node *bucketHead(size_type pos) const
+  {
+    if(head == nullptr)
+      return small[pos];
+    return pos < oldSize ? oldHead[pos] : head[pos - oldSize];
+  }
+
+  /* bucket count is kept a power of two, so Hash() reduces with a mask instead of % */
+  static size_type tableSize(size_type hashSize)
+  {
+    size_type size = 1;
+    while(size < hashSize)
+      size <<= 1;
+    return size;
+  }
+
+  void allocateTable(size_type hashSize)
+  {
+    Size = tableSize(hashSize);
+    head = new Node*[Size];
+    bucketSize = new size_type[Size];
+    occupied = new std::uint64_t[bitmapWords(Size)]();
     for(size_type i = 0; i < Size; ++i)
     {
-      if(!IsEmptyB(i))
+      head[i] = nullptr;
+      bucketSize[i] = 0;
+    }
+  }
+
+  /* builds the entry in place in pool memory, out of memory is reported as in insertB */
+  template <typename... Args>
+  Node *createNode(Args&&... args)
+  {
+    void* location;
+    try
+    {
+      location = pool.allocate();
+    }
+    catch(std::bad_alloc&)
+    {
+      throw std::out_of_range("out of range, list full");
+    }
+
+    try
+    {
+      return new (location) Node(typename Node::InPlace(), std::forward<Args>(args)...);
+    }
+    catch(...)
+    {
+      pool.deallocate(static_cast<Node*>(location));
+      throw;
+    }
+  }
+
+  void destroyNode(Node *n)
+  {
+    n->~Node();
+    pool.deallocate(n);
+  }
+
+  /* empties a bucket array; nodes are returned to the pool one by one only if it cannot release in bulk */
+  void clearChains(Node **heads, size_type *sizes, std::uint64_t *bits, size_type count)
+  {
+    for(size_type i = 0; i < count; ++i)
+    {
+      if(!skipNodeWalk)
       {
-        while(!IsEmptyB(i))
+        while(heads[i] != nullptr)
         {
-          Node* tmp = head[i];
-          head[i] = head[i]->next;
-          delete tmp;
+          Node* tmp = heads[i];
+          heads[i] = heads[i]->next;
+          if(NodePool::bulkRelease)
+            tmp->~Node();
+          else
+            destroyNode(tmp);
         }
       }
-      bucketSize[i] = 0;
+      heads[i] = nullptr;
+      sizes[i] = 0;
     }
-    delete last;
-    last = nullptr;
+    for(size_type w = 0; w < bitmapWords(count); ++w)
+      bits[w] = 0;
   }
 
-  bool IsEmptyB(size_type &keyIndex) const
+  void linkFront(Node *n, size_type keyIndex)
   {
-    if(keyIndex < Size)
+    n->prev = nullptr;
+    n->next = head[keyIndex];
+    if(head[keyIndex] != nullptr)
+      head[keyIndex]->prev = n;
+    head[keyIndex] = n;
+    ++bucketSize[keyIndex];
+    setBit(occupied, keyIndex);
+    if(oldSize + keyIndex < firstBucket)
+      firstBucket = oldSize + keyIndex;
+  }
+
+  /* puts a new node into a free slot or at the head of its chain, returns its position */
+  size_type link(Node *n, size_type code)
+  {
+    if(head == nullptr)
     {
-      return head[keyIndex] == nullptr;
+      size_type i = 0;
+      while(small[i] != nullptr)
+        ++i;
+      n->next = n->prev = nullptr;
+      small[i] = n;
+      smallCode[i] = code;
+      return i;
     }
-    return true;
+    size_type keyIndex = code & (Size - 1);
+    linkFront(n, keyIndex);
+    return oldSize + keyIndex;
   }
 
-  bool IsFull()
+  void unlink(Node *n, size_type pos)
   {
-	  try
-	  {
-		   Node* location = new Node();
-		   delete location;
-		   return false;
-	   }
-	   catch(std::bad_alloc&)
-	   {
-		   return true;
-	   }
+    if(head == nullptr)
+    {
+      small[pos] = nullptr;
+      return;
+    }
+    Node **bucket = pos < oldSize ? &oldHead[pos] : &head[pos - oldSize];
+    if(n->prev != nullptr)
+      n->prev->next = n->next;
+    else
+      *bucket = n->next;
+    if(n->next != nullptr)
+      n->next->prev = n->prev;
+
+    --(pos < oldSize ? oldBucketSize[pos] : bucketSize[pos - oldSize]);
+    if(*bucket == nullptr)
+    {
+      if(pos < oldSize)
+        clearBit(oldOccupied, pos);
+      else
+        clearBit(occupied, pos - oldSize);
+    }
   }
 
-  void insertB(const value_type _data)
+  /* leaves small mode at once: there are at most smallCapacity entries to move */
+  void promote(size_type newSize)
   {
-    if(IsFull())
+    allocateTable(newSize);
+    firstBucket = Size;
+    for(size_type i = 0; i < smallCapacity; ++i)
     {
-      throw std::out_of_range("out of range, list full");
+      if(small[i] != nullptr)
+      {
+        linkFront(small[i], smallCode[i] & (Size - 1));
+        small[i] = nullptr;
+      }
     }
-    else
+  }
+
+  void startRehash(size_type newSize)
+  {
+    if(head == nullptr)
     {
-      size_type keyIndex = Hash(_data.first);
-		  Node* newNode = new Node(_data);   // add new node
-      newNode->next = newNode->prev = nullptr;
+      promote(newSize);
+      return;
+    }
+    finishRehash();
+    Node **fromHead = head;
+    size_type *fromBucketSize = bucketSize;
+    std::uint64_t *fromOccupied = occupied;
+    size_type fromSize = Size;
+    allocateTable(newSize);
 
-		  if(IsEmptyB(keyIndex))
-		  {
-			   head[keyIndex] = newNode;
-		  }
-		  else
-		  {
-			   Node* tmp = head[keyIndex];
-			   while(tmp->next != nullptr)
-			   {
-				    tmp = tmp->next;
-			   }
-			   tmp->next = newNode;
-         newNode->prev = tmp;
-         tmp = nullptr;
-		  }
-      newNode = nullptr;
-		  ++bucketSize[keyIndex];
-	    ++nrElem;
+    if(nrElem == 0)
+    {
+      delete[] fromHead;
+      delete[] fromBucketSize;
+      delete[] fromOccupied;
+      return;
     }
+    oldHead = fromHead;
+    oldBucketSize = fromBucketSize;
+    oldOccupied = fromOccupied;
+    oldSize = fromSize;
+    rehashIndex = 0;
   }
 
-  Node *findB(const key_type key) const
+  /* moves up to `count` buckets of the old table into the new one */
+  void rehashSteps(size_type count)
   {
-    Node* tmp;
-    size_type keyIndex = Hash(key);
+    if(oldHead == nullptr)
+      return;
 
-    if(IsEmptyB(keyIndex))
+    for(; count > 0 && rehashIndex < oldSize; --count, ++rehashIndex)
     {
-      return nullptr;
+      Node *n = oldHead[rehashIndex];
+      while(n != nullptr)
+      {
+        Node *next = n->next;
+        linkFront(n, Hash(n->data.first));
+        n = next;
+      }
+      oldHead[rehashIndex] = nullptr;
+      oldBucketSize[rehashIndex] = 0;
+      clearBit(oldOccupied, rehashIndex);
     }
-    else if( head[keyIndex]->data.first == key)
+
+    if(rehashIndex == oldSize)
     {
-      return head[keyIndex];
+      /* positions of the new table move down once the old one is gone */
+      firstBucket = firstBucket > oldSize ? firstBucket - oldSize : 0;
+      delete[] oldHead;
+      delete[] oldBucketSize;
+      delete[] oldOccupied;
+      oldHead = nullptr;
+      oldBucketSize = nullptr;
+      oldOccupied = nullptr;
+      oldSize = 0;
+      rehashIndex = 0;
     }
-    else
+  }
+
+  void finishRehash()
+  {
+    if(oldHead != nullptr)
+      rehashSteps(oldSize);
+  }
+
+  void growIfNeeded()
+  {
+    if(nrElem + 1 > maxLoad * Size)
+      startRehash(Size * 2);
+    else if(head == nullptr && nrElem == smallCapacity)
+      startRehash(Size);
+  }
+
+  /* finds key in both tables, pos gets its bucket position; K is key_type unless lookup is transparent */
+  template <typename K>
+  Node *findNode(const K& key, size_type &pos, MapOperation op = MapOperation::find) const
+  {
+    return findNode(key, hasher(key), pos, op);
+  }
+
+  /* op only tells the instrumentation which operation the probes count for */
+  template <typename K>
+  Node *findNode(const K& key, size_type code, size_type &pos, MapOperation op = MapOperation::find) const
+  {
+    if(head == nullptr)
+      return findSmall(key, code, pos, op);
+
+    size_type probes = 0;
+    Node *found = nullptr;
+    if(oldHead != nullptr)
+    {
+      size_type oldIndex = code & (oldSize - 1);
+      if(oldIndex >= rehashIndex)
+      {
+        for(Node *tmp = oldHead[oldIndex]; tmp != nullptr; tmp = tmp->next)
+        {
+          ++probes;
+          if(equal(tmp->data.first, key))
+          {
+            pos = oldIndex;
+            found = tmp;
+            break;
+          }
+        }
+      }
+    }
+
+    if(found == nullptr)
     {
-      for(tmp = head[keyIndex]; tmp->next != nullptr; tmp = tmp->next)
+      size_type keyIndex = code & (Size - 1);
+      for(Node *tmp = head[keyIndex]; tmp != nullptr; tmp = tmp->next)
       {
-        if(tmp->next->data.first == key)
+        ++probes;
+        if(equal(tmp->data.first, key))
         {
-          return tmp->next;
+          pos = oldSize + keyIndex;
+          found = tmp;
+          break;
         }
       }
     }
-    return nullptr;
+    instr.probed(op, probes);
+    return found;
+  }
+
+  /* small mode lookup: probes count the keys compared, as in a chain */
+  template <typename K>
+  Node *findSmall(const K& key, size_type code, size_type &pos, MapOperation op) const
+  {
+    size_type probes = 0;
+    Node *found = nullptr;
+    for(size_type i = 0; i < smallCapacity; ++i)
+    {
+      if(small[i] == nullptr || smallCode[i] != code)
+        continue;
+      ++probes;
+      if(equal(small[i]->data.first, key))
+      {
+        pos = i;
+        found = small[i];
+        break;
+      }
+    }
+    instr.probed(op, probes);
+    return found;
+  }
+
+  static void prefetch(const void *address)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+  }
+
+  /* keys of a batch are processed in groups this large, enough to keep the misses of a group in flight */
+  static const size_type batchGroup = 16;
+
+  /*
+    First two stages of a batched lookup: hashes every key of the group,
+    prefetches its bucket slots, then prefetches the first node of each
+    chain. The key comparisons that follow find both mostly in cache.
+  */
+  template <typename GetKey>
+  void prefetchGroup(GetKey getKey, size_type count, size_type *codes) const
+  {
+    if(head == nullptr)
+    {
+      /* the slots are inline, already in cache with the map */
+      for(size_type i = 0; i < count; ++i)
+        codes[i] = hasher(getKey(i));
+      return;
+    }
+    for(size_type i = 0; i < count; ++i)
+    {
+      codes[i] = hasher(getKey(i));
+      if(oldHead != nullptr)
+        prefetch(&oldHead[codes[i] & (oldSize - 1)]);
+      prefetch(&head[codes[i] & (Size - 1)]);
+    }
+    for(size_type i = 0; i < count; ++i)
+    {
+      if(oldHead != nullptr)
+      {
+        size_type oldIndex = codes[i] & (oldSize - 1);
+        if(oldIndex >= rehashIndex && oldHead[oldIndex] != nullptr)
+          prefetch(oldHead[oldIndex]);
+      }
+      Node *first = head[codes[i] & (Size - 1)];
+      if(first != nullptr)
+        prefetch(first);
+    }
+  }
+
+  /* looks up n <= batchGroup keys: out[i] is the entry of keys[i] or end(), returns the number found */
+  size_type findGroup(const key_type *keys, size_type n, const_iterator *out) const
+  {
+    size_type codes[batchGroup];
+    size_type found = 0;
+    prefetchGroup([&](size_type i) -> const key_type& { return keys[i]; }, n, codes);
+    for(size_type i = 0; i < n; ++i)
+    {
+      size_type pos;
+      Node *t = findNode(keys[i], codes[i], pos);
+      out[i] = t == nullptr ? cend() : makeIterator(t, pos);
+      found += t != nullptr;
+    }
+    return found;
+  }
+
+  /* first non-empty bucket position >= pos, positions() if there is none */
+  size_type nextBucket(size_type pos) const
+  {
+    if(head == nullptr)
+    {
+      while(pos < smallCapacity && small[pos] == nullptr)
+        ++pos;
+      return pos;
+    }
+    if(pos < oldSize)
+    {
+      size_type found = nextSet(oldOccupied, pos, oldSize);
+      if(found < oldSize)
+        return found;
+      pos = oldSize;
+    }
+    return oldSize + nextSet(occupied, pos - oldSize, Size);
+  }
+
+  /* last non-empty bucket position < pos, positions() if there is none */
+  size_type prevBucket(size_type pos) const
+  {
+    if(head == nullptr)
+    {
+      while(pos > 0)
+      {
+        if(small[--pos] != nullptr)
+          return pos;
+      }
+      return smallCapacity;
+    }
+    if(pos > oldSize)
+    {
+      size_type found = pos - oldSize;
+      if(prevSet(occupied, found))
+        return oldSize + found;
+      pos = oldSize;
+    }
+    if(prevSet(oldOccupied, pos))
+      return pos;
+    return positions();
+  }
+
+  const_iterator makeIterator(Node *t, size_type pos) const
+  {
+    ConstIterator it;
+    it.cptr = t;
+    it.bucket = pos;
+    it.ptrMap = this;
+    return it;
+  }
+
+  /* the entry after n, which sits at position pos, in iteration order */
+  const_iterator successor(Node *n, size_type pos) const
+  {
+    if(n->next != nullptr)
+      return makeIterator(n->next, pos);
+    pos = nextBucket(pos + 1);
+    return makeIterator(pos == positions() ? nullptr : bucketHead(pos), pos);
+  }
+
+  template <typename K>
+  const_iterator findKey(const K& key) const
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::find);
+    size_type pos;
+    Node* t = findNode(key, pos);
+
+    if(t == nullptr)
+      return cend();
+    return makeIterator(t, pos);
+  }
+
+  template <typename K>
+  Node *valueNode(const K& key) const
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::find);
+    size_type pos;
+    Node *t = findNode(key, pos);
+    if(t == nullptr)
+      throw std::out_of_range("out of range");
+    return t;
   }
 
-  void removeB(const key_type key)
+  template <typename K>
+  void removeKey(const K& key)
   {
-    if(findB(key) == nullptr)
+    typename Instrumentation::Scope timer(instr, MapOperation::remove);
+    rehashSteps(rehashStep);
+
+    size_type pos;
+    Node *tmp = findNode(key, pos, MapOperation::remove);
+    if(tmp == nullptr)
       throw std::out_of_range("out of range, no such elem to remove");
-    else
+
+    unlink(tmp, pos);
+    destroyNode(tmp);
+    --nrElem;
+  }
+
+  /* heterogeneous overloads only exist for transparent Hasher and KeyEqual, iterators keep going to remove(const_iterator) */
+  template <typename K>
+  using IfTransparent = typename std::enable_if<IsTransparent<Hasher>::value
+                                                && IsTransparent<KeyEqual>::value
+                                                && !std::is_convertible<const K&, const_iterator>::value, K>::type;
+
+  void takeSlots(HashMap& other)
+  {
+    for(size_type i = 0; i < smallCapacity; ++i)
+    {
+      small[i] = other.small[i];
+      smallCode[i] = other.smallCode[i];
+      other.small[i] = nullptr;
+    }
+  }
+
+  /* copies the chain starting at src into *dst, in the same order */
+  void cloneChain(const Node *src, Node **dst)
+  {
+    Node *prev = nullptr;
+    for(; src != nullptr; src = src->next)
     {
-      Node* tmp;
-      size_type keyIndex = Hash(key);
+      Node *n = createNode(src->data);
+      n->next = nullptr;
+      n->prev = prev;
+      *dst = n;
+      dst = &n->next;
+      prev = n;
+    }
+  }
 
-      if( head[keyIndex]->data.first == key)
+  /* copies bucket heads, counters and the occupancy bitmap of a table of count buckets */
+  void cloneTable(Node **heads, size_type *sizes, std::uint64_t *bits,
+                  Node *const *fromHeads, const size_type *fromSizes, const std::uint64_t *fromBits,
+                  size_type count)
+  {
+    for(size_type i = 0; i < count; ++i)
+    {
+      if(fromHeads[i] != nullptr)
+        cloneChain(fromHeads[i], &heads[i]);
+      sizes[i] = fromSizes[i];
+    }
+    for(size_type w = 0; w < bitmapWords(count); ++w)
+      bits[w] = fromBits[w];
+  }
+
+  /*
+    Structural copy of other into this map, which must be empty and not
+    rehashing: same bucket count and positions, chains in the same order,
+    so no key is hashed or compared, and all nodes are asked of the pool
+    at once. A pending incremental rehash is copied as it is. If an entry
+    fails to copy the map is left empty.
+  */
+  void cloneFrom(const HashMap& other)
+  {
+    if(head != nullptr && (other.head == nullptr || Size != other.Size))
+    {
+      delete[] head;
+      delete[] bucketSize;
+      delete[] occupied;
+      head = nullptr;
+      bucketSize = nullptr;
+      occupied = nullptr;
+    }
+    Size = other.Size;
+    firstBucket = other.firstBucket;
+    pool.reserve(other.nrElem);
+
+    try
+    {
+      if(other.head == nullptr)
       {
-        tmp = head[keyIndex];
-        head[keyIndex] = head[keyIndex]->next;
-        --nrElem;
-        --bucketSize[keyIndex];
-        delete tmp;
+        for(size_type i = 0; i < smallCapacity; ++i)
+        {
+          if(other.small[i] == nullptr)
+            continue;
+          small[i] = createNode(other.small[i]->data);
+          small[i]->next = small[i]->prev = nullptr;
+          smallCode[i] = other.smallCode[i];
+        }
+        nrElem = other.nrElem;
+        return;
       }
-      else
+
+      if(head == nullptr)
+        allocateTable(Size);
+      if(other.oldHead != nullptr)
       {
-        for(tmp = head[keyIndex]; tmp->next != nullptr; tmp = tmp->next)
+        oldHead = new Node*[other.oldSize]();
+        oldBucketSize = new size_type[other.oldSize]();
+        oldOccupied = new std::uint64_t[bitmapWords(other.oldSize)]();
+        oldSize = other.oldSize;
+        rehashIndex = other.rehashIndex;
+        cloneTable(oldHead, oldBucketSize, oldOccupied,
+                   other.oldHead, other.oldBucketSize, other.oldOccupied, oldSize);
+      }
+      cloneTable(head, bucketSize, occupied, other.head, other.bucketSize, other.occupied, Size);
+      nrElem = other.nrElem;
+    }
+    catch(...)
+    {
+      makeEmpty();
+      throw;
+    }
+  }
+
+  /* after a move: empty small map planned like a default one, nothing of the old table is freed */
+  void forgetTable()
+  {
+    head = nullptr;
+    bucketSize = nullptr;
+    occupied = nullptr;
+    oldHead = nullptr;
+    oldBucketSize = nullptr;
+    oldOccupied = nullptr;
+    oldSize = rehashIndex = 0;
+    Size = defaultSize;
+    nrElem = 0;
+    firstBucket = Size;
+  }
+
+public:
+
+  size_type Hash(const key_type& key) const
+  {
+    return hasher(key) & (Size - 1);
+  }
+
+  void makeEmpty()
+  {
+    nrElem = 0;
+    if(head == nullptr)
+    {
+      for(size_type i = 0; i < smallCapacity; ++i)
+      {
+        if(small[i] != nullptr && !skipNodeWalk)
         {
-          if(tmp->next->data.first == key)
-          {
-            Node* deleteNode = tmp->next;
-            tmp->next = tmp->next->next;
-            delete deleteNode;
-            --nrElem;
-            --bucketSize[keyIndex];
-            break;
-          }
+          if(NodePool::bulkRelease)
+            small[i]->~Node();
+          else
+            destroyNode(small[i]);
         }
+        small[i] = nullptr;
       }
+      pool.release();
+      return;
+    }
+    if(oldHead != nullptr)
+    {
+      clearChains(oldHead, oldBucketSize, oldOccupied, oldSize);
+      delete[] oldHead;
+      delete[] oldBucketSize;
+      delete[] oldOccupied;
+      oldHead = nullptr;
+      oldBucketSize = nullptr;
+      oldOccupied = nullptr;
+      oldSize = rehashIndex = 0;
+    }
+    clearChains(head, bucketSize, occupied, Size);
+    firstBucket = Size;
+    pool.release();
+  }
+
+  bool IsEmptyB(size_type &keyIndex) const
+  {
+    if(head == nullptr)
+    {
+      for(size_type i = 0; i < smallCapacity; ++i)
+      {
+        if(small[i] != nullptr && (smallCode[i] & (Size - 1)) == keyIndex)
+          return false;
+      }
+      return true;
+    }
+    if(keyIndex < Size)
+    {
+      return head[keyIndex] == nullptr;
     }
+    return true;
   }
 
+  /* insertB: no lookup, the entry is copied or moved straight into its node */
+  template <typename V>
+  void insertValue(V&& _data)
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::insert);
+    rehashSteps(rehashStep);
+    growIfNeeded();
+
+    Node* newNode = createNode(std::forward<V>(_data));
+    link(newNode, hasher(newNode->data.first));
+    ++nrElem;
+    instr.probed(MapOperation::insert, 0);
+  }
 
-  HashMap()
+  /* hashes once: the same code locates an existing entry and places the new one */
+  template <typename K, typename... Args>
+  std::pair<iterator, bool> tryEmplaceB(K&& key, Args&&... args)
   {
-    Size = defaultSize;
-    head = new Node*[Size+1];
-    bucketSize = new size_type[Size];
-    for(size_type i = 0; i < Size; ++i)
+    rehashSteps(rehashStep);
+
+    size_type code = hasher(key);
+    size_type pos;
+    Node *t = findNode(key, code, pos, MapOperation::insert);
+    if(t != nullptr)
+      return std::pair<iterator, bool>(iterator(makeIterator(t, pos)), false);
+
+    growIfNeeded();
+    t = createNode(std::piecewise_construct,
+                   std::forward_as_tuple(std::forward<K>(key)),
+                   std::forward_as_tuple(std::forward<Args>(args)...));
+    pos = link(t, code);
+    ++nrElem;
+    return std::pair<iterator, bool>(iterator(makeIterator(t, pos)), true);
+  }
+
+  /* at most one allocation: new node goes to the chain head, out of memory surfaces from new itself */
+  void insertB(const value_type& _data)
+  {
+    insertValue(_data);
+  }
+
+  /* the key of a value_type is const and still gets copied; try_emplace(std::move(key), ...) copies nothing */
+  void insertB(value_type&& _data)
+  {
+    insertValue(std::move(_data));
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args)
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::insert);
+    return tryEmplaceB(key, std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args)
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::insert);
+    return tryEmplaceB(std::move(key), std::forward<Args>(args)...);
+  }
+
+  /* the entry is built first to learn its key, and dropped again if the key is taken */
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args)
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::insert);
+    rehashSteps(rehashStep);
+
+    Node *t = createNode(std::forward<Args>(args)...);
+    size_type code = hasher(t->data.first);
+    size_type pos;
+    Node *found = findNode(t->data.first, code, pos, MapOperation::insert);
+    if(found != nullptr)
     {
-      head[i] = nullptr;
-      bucketSize[i] = 0;
+      destroyNode(t);
+      return std::pair<iterator, bool>(iterator(makeIterator(found, pos)), false);
     }
-    head[Size] = new Node();   // end
-    last = head[Size];
-    nrElem = 0;
+
+    try
+    {
+      growIfNeeded();
+    }
+    catch(...)
+    {
+      destroyNode(t);
+      throw;
+    }
+    pos = link(t, code);
+    ++nrElem;
+    return std::pair<iterator, bool>(iterator(makeIterator(t, pos)), true);
   }
 
-  HashMap(size_type hashSize)
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& obj)
   {
-    Size = hashSize;
-    head = new Node*[Size+1];
-    bucketSize = new size_type[Size];
-    for(size_type i = 0; i < Size; ++i)
+    typename Instrumentation::Scope timer(instr, MapOperation::insert);
+    auto result = tryEmplaceB(key, std::forward<M>(obj));
+    if(!result.second)
+      result.first->second = std::forward<M>(obj);
+    return result;
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& obj)
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::insert);
+    auto result = tryEmplaceB(std::move(key), std::forward<M>(obj));
+    if(!result.second)
+      result.first->second = std::forward<M>(obj);
+    return result;
+  }
+
+  /*
+    Looks up count keys at once: out[i] is the entry of keys[i] or end().
+    The hashing, bucket and first-node fetches of a group of keys are
+    issued before any key is compared, so their cache misses overlap.
+    Returns the number of keys found. The whole call is timed as one find.
+  */
+  size_type findMany(const key_type *keys, size_type count, const_iterator *out) const
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::find);
+    size_type found = 0;
+    for(size_type base = 0; base < count; base += batchGroup)
     {
-      head[i] = nullptr;
-      bucketSize[i] = 0;
+      size_type n = count - base < batchGroup ? count - base : batchGroup;
+      found += findGroup(keys + base, n, out + base);
     }
-    head[Size] = new Node(); // end
-    last = head[Size];
+    return found;
+  }
+
+  size_type findMany(const key_type *keys, size_type count, iterator *out)
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::find);
+    const_iterator group[batchGroup];
+    size_type found = 0;
+    for(size_type base = 0; base < count; base += batchGroup)
+    {
+      size_type n = count - base < batchGroup ? count - base : batchGroup;
+      found += findGroup(keys + base, n, group);
+      for(size_type i = 0; i < n; ++i)
+        out[base + i] = iterator(group[i]);
+    }
+    return found;
+  }
+
+  /*
+    Inserts count entries like try_emplace: keys already present (also
+    earlier in the same batch) keep their value. The table is grown once
+    up front for the whole batch, and recorded as a single insert.
+    Returns the number of entries inserted.
+  */
+  size_type insertMany(const value_type *items, size_type count)
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::insert);
+    rehashSteps(rehashStep);
+    if(nrElem + count > maxLoad * Size)
+      reserve(nrElem + count);
+    else if(head == nullptr && nrElem + count > smallCapacity)
+      startRehash(Size);
+
+    size_type codes[batchGroup];
+    size_type inserted = 0;
+    for(size_type base = 0; base < count; base += batchGroup)
+    {
+      size_type n = count - base < batchGroup ? count - base : batchGroup;
+      prefetchGroup([&](size_type i) -> const key_type& { return items[base + i].first; }, n, codes);
+      for(size_type i = 0; i < n; ++i)
+      {
+        size_type pos;
+        if(findNode(items[base + i].first, codes[i], pos, MapOperation::insert) != nullptr)
+          continue;
+        Node *t = createNode(items[base + i]);
+        link(t, codes[i]);
+        ++nrElem;
+        ++inserted;
+      }
+    }
+    return inserted;
+  }
+
+  Node *findB(const key_type& key) const
+  {
+    size_type pos;
+    return findNode(key, pos);
+  }
+
+  void removeB(const key_type& key)
+  {
+    removeKey(key);
+  }
+
+  /* number of buckets elements are (being) hashed into */
+  size_type bucket_count() const
+  {
+    return Size;
+  }
+
+  float load_factor() const
+  {
+    return static_cast<float>(nrElem) / Size;
+  }
+
+  float max_load_factor() const
+  {
+    return maxLoad;
+  }
+
+  /* takes effect on the next insert */
+  void max_load_factor(float ml)
+  {
+    if(!(ml > 0))
+      throw std::out_of_range("out of range, max load factor must be positive");
+    maxLoad = ml;
+  }
+
+  /* unlike growth on insert, an explicit rehash is done at once */
+  void rehash(size_type count)
+  {
+    size_type needed = static_cast<size_type>(nrElem / maxLoad) + 1;
+    startRehash(count > needed ? count : needed);
+    finishRehash();
+  }
+
+  void reserve(size_type count)
+  {
+    rehash(static_cast<size_type>(count / maxLoad) + 1);
+  }
+
+  /* chain lengths of both tables while a rehash is in progress; migrated old buckets are left out */
+  HashMapStats stats() const
+  {
+    HashMapStats s;
+    s.size = nrElem;
+    s.bucketCount = Size;
+    s.loadFactor = load_factor();
+    s.chainHistogram.assign(1, 0);
+
+    size_type buckets = 0;
+    auto count = [&](size_type length) {
+      if(length >= s.chainHistogram.size())
+        s.chainHistogram.resize(length + 1, 0);
+      ++s.chainHistogram[length];
+      ++buckets;
+    };
+    if(head == nullptr)
+    {
+      /* the chains the entries would form in the planned table */
+      size_type used = 0;
+      for(size_type i = 0; i < smallCapacity; ++i)
+      {
+        if(small[i] == nullptr)
+          continue;
+        size_type length = 0;
+        bool firstOfBucket = true;
+        for(size_type j = 0; j < smallCapacity; ++j)
+        {
+          if(small[j] == nullptr || ((smallCode[j] ^ smallCode[i]) & (Size - 1)) != 0)
+            continue;
+          firstOfBucket = firstOfBucket && j >= i;
+          ++length;
+        }
+        if(firstOfBucket)
+        {
+          count(length);
+          ++used;
+        }
+      }
+      s.chainHistogram[0] += Size - used;
+      buckets += Size - used;
+    }
+    for(size_type i = rehashIndex; oldHead != nullptr && i < oldSize; ++i)
+      count(oldBucketSize[i]);
+    for(size_type i = 0; head != nullptr && i < Size; ++i)
+      count(bucketSize[i]);
+
+    size_type empty = s.chainHistogram[0];
+    size_type used = buckets - empty;
+    s.maxChain = s.chainHistogram.size() - 1;
+    s.meanChain = used == 0 ? 0.0 : static_cast<double>(nrElem) / used;
+    s.emptyBucketRatio = buckets == 0 ? 0.0 : static_cast<double>(empty) / buckets;
+
+    s.p99Chain = 0;
+    size_type seen = 0;
+    for(size_type length = 1; length < s.chainHistogram.size(); ++length)
+    {
+      seen += s.chainHistogram[length];
+      if(seen * 100 >= used * 99)
+      {
+        s.p99Chain = length;
+        break;
+      }
+    }
+    return s;
+  }
+
+  /* bytes the map holds, see MemoryUsage; small mode slots are part of the object */
+  MemoryUsage memory_usage() const
+  {
+    MemoryUsage m;
+    m.objectBytes = sizeof(*this);
+    m.bucketBytes = 0;
+    m.overheadBytes = pool.overheadBytes(nrElem);
+    auto addTable = [&](size_type buckets) {
+      size_type parts[3] = { buckets * sizeof(Node*),
+                             buckets * sizeof(size_type),
+                             bitmapWords(buckets) * sizeof(std::uint64_t) };
+      for(size_type bytes : parts)
+      {
+        m.bucketBytes += bytes;
+        m.overheadBytes += allocationOverhead(bytes);
+      }
+    };
+    if(head != nullptr)
+      addTable(Size);
+    if(oldHead != nullptr)
+      addTable(oldSize);
+
+    m.nodeBytes = nrElem * sizeof(Node);
+    m.payloadBytes = nrElem * sizeof(value_type);
+    return m;
+  }
+
+  /* probe counters of the Instrumentation policy */
+  const Instrumentation& instrumentation() const
+  {
+    return instr;
+  }
+
+  Instrumentation& instrumentation()
+  {
+    return instr;
+  }
+
+  HashMap()
+    :HashMap(defaultSize)
+  {}
+
+  /* allocates nothing: the table of hashSize buckets is made once the inline slots overflow */
+  HashMap(size_type hashSize,
+          const Hasher& hash = Hasher(),
+          const KeyEqual& keyEqual = KeyEqual())
+    :hasher(hash), equal(keyEqual)
+  {
+    head = nullptr;
+    bucketSize = nullptr;
+    occupied = nullptr;
+    Size = tableSize(hashSize);
+    for(size_type i = 0; i < smallCapacity; ++i)
+      small[i] = nullptr;
     nrElem = 0;
+    oldHead = nullptr;
+    oldBucketSize = nullptr;
+    oldOccupied = nullptr;
+    oldSize = rehashIndex = 0;
+    firstBucket = Size;
+    maxLoad = 1.0f;
   }
 
   ~HashMap()
   {
     makeEmpty();
-    if(last != nullptr)
-      delete last;
-
     delete[] head;
     delete[] bucketSize;
+    delete[] occupied;
   }
 
   HashMap(std::initializer_list<value_type> list)
@@ -266,62 +1262,73 @@ public:
       insertB(*it);
   }
 
+  /* O(n) structural copy, see cloneFrom() */
   HashMap(const HashMap& other)
-    :HashMap(other.Size)
+    :HashMap(other.Size, other.hasher, other.equal)
   {
-    for(auto it = other.begin(); it != other.end(); ++it)
-    {
-      insertB(*it);
-    }
+    maxLoad = other.maxLoad;
+    cloneFrom(other);
   }
 
+  /* O(1): steals the table or copies the inline slots, other is left an empty small map */
   HashMap(HashMap&& other)
+    :hasher(other.hasher), equal(other.equal), pool(std::move(other.pool))
   {
     head = other.head;
-    last = other.last;
     Size = other.Size;
     nrElem = other.nrElem;
     bucketSize = other.bucketSize;
-    other.head = nullptr;
-    other.last = nullptr;
-    other.Size = 0;
-    other.nrElem = 0;
-    other.bucketSize = nullptr;
+    occupied = other.occupied;
+    oldHead = other.oldHead;
+    oldBucketSize = other.oldBucketSize;
+    oldOccupied = other.oldOccupied;
+    oldSize = other.oldSize;
+    rehashIndex = other.rehashIndex;
+    firstBucket = other.firstBucket;
+    maxLoad = other.maxLoad;
+    takeSlots(other);
+    other.forgetTable();
   }
 
   HashMap& operator=(const HashMap& other)
   {
-    if(head == other.head)
+    if(this == &other)
       return *this;
 
     makeEmpty();
-    HashMap(other.Size);
-    for(auto it = other.begin(); it != other.end(); ++it)
-    {
-      insertB(*it);
-    }
+    hasher = other.hasher;
+    equal = other.equal;
+    maxLoad = other.maxLoad;
+    cloneFrom(other);
     return *this;
   }
 
   HashMap& operator=(HashMap&& other)
   {
-    if(head == other.head)
+    if(this == &other)
       return *this;
 
     makeEmpty();
     delete[] head;
     delete[] bucketSize;
-    bucketSize = nullptr;
+    delete[] occupied;
     head = other.head;
-    last = other.last;
     Size = other.Size;
     nrElem = other.nrElem;
     bucketSize = other.bucketSize;
-    other.head = nullptr;
-    other.last = nullptr;
-    other.Size = 0;
-    other.nrElem = 0;
-    other.bucketSize = nullptr;
+    occupied = other.occupied;
+    oldHead = other.oldHead;
+    oldBucketSize = other.oldBucketSize;
+    oldOccupied = other.oldOccupied;
+    oldSize = other.oldSize;
+    rehashIndex = other.rehashIndex;
+    firstBucket = other.firstBucket;
+    maxLoad = other.maxLoad;
+    hasher = other.hasher;
+    equal = other.equal;
+    pool = std::move(other.pool);
+    takeSlots(other);
+    other.forgetTable();
     return *this;
   }
 
@@ -335,79 +1342,108 @@ public:
 
   mapped_type& operator[](const key_type& key)
   {
-    Node* t = findB(key);
-    if(t == nullptr)
-    {
-      value_type _data(key, mapped_type());
-      insertB(_data);
-      t = findB(key);
-    }
-    return t->data.second;
+    typename Instrumentation::Scope timer(instr, MapOperation::subscript);
+    return tryEmplaceB(key).first->second;
+  }
+
+  mapped_type& operator[](key_type&& key)
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::subscript);
+    return tryEmplaceB(std::move(key)).first->second;
   }
 
   const mapped_type& valueOf(const key_type& key) const
   {
-    if(findB(key) == nullptr)
-    {
-      throw std::out_of_range("out of range");
-    }
-    else
-    {
-      return findB(key)->data.second;
-    }
+    return valueNode(key)->data.second;
   }
 
   mapped_type& valueOf(const key_type& key)
   {
-    if(findB(key) == nullptr)
-    {
-      throw std::out_of_range("out of range");
-    }
-    else
-    {
-      return findB(key)->data.second;
-    }
+    return valueNode(key)->data.second;
   }
 
-  const_iterator find(const key_type& key) const
+  template <typename K, typename = IfTransparent<K>>
+  const mapped_type& valueOf(const K& key) const
   {
-    Node* t = findB(key);
+    return valueNode(key)->data.second;
+  }
 
-    if(t == nullptr)
-    {
-       t = last;
-    }
-    ConstIterator it;
-    it.cptr = t;
-    it.ptrMap = this;
+  template <typename K, typename = IfTransparent<K>>
+  mapped_type& valueOf(const K& key)
+  {
+    return valueNode(key)->data.second;
+  }
 
-    return it;
+  const_iterator find(const key_type& key) const
+  {
+    return findKey(key);
   }
 
   iterator find(const key_type& key)
   {
-    //const_iterator it = find(key);
-    Node* t = findB(key);
+    return iterator(findKey(key));
+  }
 
-    if(t == nullptr)
-    {
-       t = last;
-    }
-    ConstIterator it;
-    it.cptr = t;
-    it.ptrMap = this;
+  template <typename K, typename = IfTransparent<K>>
+  const_iterator find(const K& key) const
+  {
+    return findKey(key);
+  }
+
+  template <typename K, typename = IfTransparent<K>>
+  iterator find(const K& key)
+  {
+    return iterator(findKey(key));
+  }
+
+  bool contains(const key_type& key) const
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::find);
+    size_type pos;
+    return findNode(key, pos) != nullptr;
+  }
 
-	return iterator(it);
+  template <typename K, typename = IfTransparent<K>>
+  bool contains(const K& key) const
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::find);
+    size_type pos;
+    return findNode(key, pos) != nullptr;
   }
 
   void remove(const key_type& key)
   {
-    removeB(key);
+    removeKey(key);
+  }
+
+  template <typename K, typename = IfTransparent<K>>
+  void remove(const K& key)
+  {
+    removeKey(key);
+  }
+
+  /*
+    Unlinks the entry through its own links, without hashing or searching,
+    and returns the entry after it. Other iterators stay valid. The
+    incremental rehash is not advanced here, as that would move the entry
+    the returned iterator points to.
+  */
+  iterator erase(const const_iterator& it)
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::remove);
+    if(it.cptr == nullptr || it.ptrMap != this)
+      throw std::out_of_range("out of range, no such elem to remove");
+
+    const_iterator next = successor(it.cptr, it.bucket);
+    unlink(it.cptr, it.bucket);
+    destroyNode(it.cptr);
+    --nrElem;
+    return iterator(next);
   }
 
   void remove(const const_iterator& it)
   {
-    removeB(it->first);
+    erase(it);
   }
 
   size_type getSize() const
@@ -417,7 +1453,7 @@ public:
 
   bool operator==(const HashMap& other) const
   {
-    if(getSize() != other.getSize() || Size != other.Size)
+    if(getSize() != other.getSize())
       return false;
 
     for(const auto& a : other)
@@ -446,31 +1482,21 @@ public:
 
   const_iterator cbegin() const
   {
-    ConstIterator it;
-
     if(isEmpty())
-      it.cptr = last;
-    else
+      return cend();
+    if(head == nullptr)
     {
-      for(size_type i = 0; i < Size; ++i)
-      {
-        if(bucketSize[i] != 0)
-        {
-          it.cptr = head[i];
-          break;
-        }
-      }
+      size_type pos = nextBucket(0);
+      return makeIterator(small[pos], pos);
     }
-    it.ptrMap = this;
-    return it;
+
+    firstBucket = nextBucket(firstBucket);
+    return makeIterator(bucketHead(firstBucket), firstBucket);
   }
 
   const_iterator cend() const
   {
-    ConstIterator it;
-    it.cptr = last;
-    it.ptrMap = this;
-    return it;
+    return makeIterator(nullptr, positions());
   }
 
   const_iterator begin() const
@@ -484,8 +1510,8 @@ public:
   }
 };
 
-template <typename KeyType, typename ValueType>
-class HashMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Hasher, typename KeyEqual, typename NodePolicy, typename Instrumentation>
+class HashMap<KeyType, ValueType, Hasher, KeyEqual, NodePolicy, Instrumentation>::ConstIterator
 {
   friend class HashMap;
 
@@ -496,8 +1522,9 @@ public:
   using pointer = const typename HashMap::value_type*;
 
 private:
-  HashMap<KeyType, ValueType>::Node *cptr;
-  const HashMap<KeyType, ValueType> *ptrMap;
+  typename HashMap::Node *cptr;
+  const HashMap *ptrMap;
+  size_type bucket;
 
 public:
 
@@ -505,43 +1532,35 @@ public:
   {
     cptr = nullptr;
     ptrMap = nullptr;
+    bucket = 0;
   }
 
   ConstIterator(const ConstIterator& other)
   {
     cptr = other.cptr;
     ptrMap = other.ptrMap;
+    bucket = other.bucket;
   }
 
+  ConstIterator& operator=(const ConstIterator& other) = default;
+
   ConstIterator& operator++()
   {
-    size_type i = ptrMap->Hash(cptr->data.first);
-    if(cptr->next == nullptr)
-    {
-      if(cptr == ptrMap->last)
-        throw std::out_of_range("out of range (on last)");
-      else
-      {
-        if(ptrMap->head[i+1] == nullptr)
-        {
-          for(size_type j = i+2; j < ptrMap->Size; ++j)
-          {
-            if(ptrMap->bucketSize[j] != 0)
-            {
-              cptr = ptrMap->head[j];
-              return *this;
-            }
-          }
-          cptr = ptrMap->last;
-        }
-        else
-          cptr = ptrMap->head[i+1];
-      }
-    }
-    else
+    typename Instrumentation::Scope timer(ptrMap->instr, MapOperation::iterate);
+    if(cptr == nullptr)
+      throw std::out_of_range("out of range (on last)");
+
+    if(cptr->next != nullptr)
     {
       cptr = cptr->next;
+      return *this;
     }
+
+    bucket = ptrMap->nextBucket(bucket + 1);
+    if(bucket == ptrMap->positions())
+      cptr = nullptr;
+    else
+      cptr = ptrMap->bucketHead(bucket);
     return *this;
   }
 
@@ -554,41 +1573,22 @@ public:
 
   ConstIterator& operator--()
   {
-    size_type i;
-    if(cptr == ptrMap->last)
-      i = ptrMap->Size;
-    else
-      i = ptrMap->Hash(cptr->data.first);
-
-    if(cptr->prev == nullptr)
+    typename Instrumentation::Scope timer(ptrMap->instr, MapOperation::iterate);
+    if(cptr != nullptr && cptr->prev != nullptr)
     {
-      if(cptr == ptrMap->head[0])
-        throw std::out_of_range("out of range (on first)");
-      else
-      {
-        if(ptrMap->head[i-1] == nullptr)
-        {
-          for(size_type j = i-2; j > 0; --j)
-          {
-            if(ptrMap->bucketSize[j] != 0)
-            {
-              cptr = ptrMap->head[j];
-              while(cptr->next != nullptr)
-              {
-                cptr = cptr->next;
-              }
-              return *this;
-            }
-          }
-          throw std::out_of_range("out of range (on first)");
-        }
-        else
-          cptr = ptrMap->head[i+1];
-      }
+      cptr = cptr->prev;
+      return *this;
     }
-    else
+
+    size_type j = ptrMap->prevBucket(bucket);
+    if(j == ptrMap->positions())
+      throw std::out_of_range("out of range (on first)");
+
+    bucket = j;
+    cptr = ptrMap->bucketHead(bucket);
+    while(cptr->next != nullptr)
     {
-      cptr = cptr->prev;
+      cptr = cptr->next;
     }
     return *this;
   }
@@ -602,7 +1602,7 @@ public:
 
   reference operator*() const
   {
-      if(cptr == nullptr || cptr == ptrMap->last)
+      if(cptr == nullptr)
         throw std::out_of_range("out of range operator*");
 
       return cptr->data;
@@ -624,8 +1624,8 @@ public:
   }
 };
 
-template <typename KeyType, typename ValueType>
-class HashMap<KeyType, ValueType>::Iterator : public HashMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Hasher, typename KeyEqual, typename NodePolicy, typename Instrumentation>
+class HashMap<KeyType, ValueType, Hasher, KeyEqual, NodePolicy, Instrumentation>::Iterator : public HashMap<KeyType, ValueType, Hasher, KeyEqual, NodePolicy, Instrumentation>::ConstIterator
 {
 public:
   using reference = typename HashMap::reference;
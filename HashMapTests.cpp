@@ -2,7 +2,10 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <map>
+#include <tuple>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -120,6 +123,23 @@ std::ostream& operator<<(std::ostream& out, const OperationCountingObject& obj)
   return out << '<' << static_cast<int>(obj) << '>';
 }
 
+} // namespace
+
+  /*dla funkcji std::hash */
+namespace std
+{
+    template <> struct hash<OperationCountingObject>
+    {
+        size_t operator()(const OperationCountingObject & x) const
+        {
+            return hash<int>()(x.get_value());
+        }
+    };
+}
+
+namespace
+{
+
 struct Fixture
 {
   Fixture()
@@ -582,6 +602,79 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenAssigningToOther_ThenAllEleme
   thenMapContainsItems(other, { { 753, "Rome" }, { 1789, "Paris" } });
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapDuringRehash_WhenCopying_ThenCopyIteratesInTheSameOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(8);
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 40; ++i)
+  {
+    map[i] = std::to_string(i);
+    expected[i] = std::to_string(i);
+  }
+
+  OperationCountingObject::resetCounters();
+  Map<K> other{map};
+
+  thenCopiedObjectsCountWas<K>(40);
+  thenMovedObjectsCountWas<K>(0);
+  BOOST_CHECK_EQUAL(other.bucket_count(), map.bucket_count());
+  auto it = other.begin();
+  for (const auto& item : map)
+  {
+    BOOST_REQUIRE(it != other.end());
+    BOOST_CHECK_EQUAL(it->first, item.first);
+    ++it;
+  }
+  BOOST_CHECK(it == other.end());
+
+  map.remove(7);
+  for (int i = 40; i < 200; ++i)
+  {
+    other[i] = std::to_string(i);
+    expected[i] = std::to_string(i);
+  }
+  thenMapContainsItems(other, expected);
+  BOOST_CHECK_EQUAL(map.getSize(), 39);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSmallMap_WhenAssigningToMapWithTable_ThenOtherBecomesSmallCopy,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
+  Map<K> other;
+  for (int i = 0; i < 100; ++i)
+    other[i] = "x";
+
+  other = map;
+  thenMapContainsItems(other, { { 753, "Rome" }, { 1789, "Paris" } });
+  BOOST_CHECK(other.begin()->first == map.begin()->first);
+
+  for (int i = 0; i < 20; ++i)
+    other[i] = "y";
+  BOOST_CHECK_EQUAL(other.getSize(), 22);
+  BOOST_CHECK_EQUAL(other.valueOf(753), "Rome");
+  BOOST_CHECK_EQUAL(other.valueOf(19), "y");
+}
+
+BOOST_AUTO_TEST_CASE(GivenPooledMap_WhenCopying_ThenCopyTakesItsNodesInOneSlab)
+{
+  aisdi::HashMap<int, int, std::hash<int>, std::equal_to<int>, aisdi::PooledNodes<>> map;
+  for (int i = 0; i < 1000; ++i)
+    map[i] = i;
+
+  auto copy = map;
+
+  BOOST_CHECK_EQUAL(copy.getSize(), 1000);
+  BOOST_CHECK_EQUAL(copy.valueOf(999), 999);
+  BOOST_CHECK_EQUAL(copy.memory_usage().nodeBytes, map.memory_usage().nodeBytes);
+  BOOST_CHECK(copy.memory_usage().overheadBytes < map.memory_usage().overheadBytes);
+  copy[1000] = 1000;
+  BOOST_CHECK_EQUAL(copy.getSize(), 1001);
+}
+
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenSelfAssigning_ThenNothingHappens,
                               K,
                               TestedKeyTypes)
@@ -630,7 +723,7 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenMoveAssigning_ThenAllElements
   thenCopiedObjectsCountWas<K>(0);
   thenAssignedObjectsCountWas<K>(0);
   thenMovedObjectsCountWas<K>(0);
-  thenDestroyedObjectsCountWas<K>(3);
+  thenDestroyedObjectsCountWas<K>(2);
   thenMapContainsItems(other, { { 753, "Rome" }, { 1789, "Paris" } });
 }
 
@@ -793,19 +886,551 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithDifferentKeys_WhenComparingThem_Th
   BOOST_CHECK(map != other);
 }
 
-// ConstIterator is tested via Iterator methods.
-// If Iterator methods are to be changed, then new ConstIterator tests are required.
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSmallMap_WhenAddingManyItems_ThenItGrowsAndAllItemsAreInMap,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(4);
+  std::map<K, std::string> expected;
 
-BOOST_AUTO_TEST_SUITE_END()
+  for (int i = 0; i < 1000; ++i)
+  {
+    map[i] = std::to_string(i);
+    expected[i] = std::to_string(i);
+    BOOST_CHECK(map.load_factor() <= map.max_load_factor());
+  }
 
-  /*dla funkcji std::hash */
-namespace std
+  BOOST_CHECK(map.bucket_count() >= 1000);
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapDuringRehash_WhenIteratingAndRemoving_ThenEveryItemIsSeenOnce,
+                              K,
+                              TestedKeyTypes)
 {
-    template <> struct hash<OperationCountingObject>
-    {
-        size_t operator()(const OperationCountingObject & x) const
-        {
-            return hash<int>()(x.get_value());
-        }
-    };
+  Map<K> map(8);
+  for (int i = 0; i < 9; ++i)
+    map[i] = "x";
+
+  std::map<K, int> seen;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    ++seen[it->first];
+  BOOST_CHECK_EQUAL(seen.size(), 9);
+
+  std::size_t backwards = 0;
+  for (auto it = map.end(); it != map.begin(); --it)
+    ++backwards;
+  BOOST_CHECK_EQUAL(backwards, 9);
+
+  map.remove(0);
+  map.remove(8);
+  thenMapContainsItems(map, { { 1, "x" }, { 2, "x" }, { 3, "x" }, { 4, "x" },
+                              { 5, "x" }, { 6, "x" }, { 7, "x" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapWithLongChains_WhenErasingDuringIteration_ThenOtherItemsAreKept,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(8);
+  map.rehash(8);
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 32; ++i)
+  {
+    map[i] = std::to_string(i);
+    if (i % 2 == 1)
+      expected[i] = std::to_string(i);
+  }
+
+  std::size_t visited = 0;
+  for (auto it = map.begin(); it != map.end(); ++visited)
+  {
+    if (static_cast<int>(it->first) % 2 == 0)
+      it = map.erase(it);
+    else
+      ++it;
+  }
+
+  BOOST_CHECK_EQUAL(visited, 32);
+  thenMapContainsItems(map, expected);
+  std::size_t backwards = 0;
+  for (auto it = map.end(); it != map.begin(); --it)
+    ++backwards;
+  BOOST_CHECK_EQUAL(backwards, 16);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapDuringRehash_WhenErasingEveryItem_ThenMapBecomesEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(8);
+  for (int i = 0; i < 9; ++i)
+    map[i] = "x";
+
+  std::size_t erased = 0;
+  for (auto it = map.begin(); it != map.end(); ++erased)
+    it = map.erase(it);
+
+  BOOST_CHECK_EQUAL(erased, 9);
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK_THROW(map.erase(map.end()), std::out_of_range);
+  map[3] = "y";
+  thenMapContainsItems(map, { { 3, "y" } });
 }
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSparseMap_WhenIteratingAndChangingFirstItem_ThenEveryItemIsSeen,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(100000);
+  map.rehash(100000);
+  map[64] = "b";
+  map[3] = "a";
+  map[65] = "c";
+  map[99999] = "d";
+
+  BOOST_CHECK(map.begin()->first == K{3});
+  std::size_t forwards = 0;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    ++forwards;
+  BOOST_CHECK_EQUAL(forwards, 4);
+
+  auto it = map.end();
+  --it;
+  BOOST_CHECK(it->first == K{99999});
+
+  map.remove(3);
+  BOOST_CHECK(map.begin()->first == K{64});
+  map[1] = "e";
+  BOOST_CHECK(map.begin()->first == K{1});
+
+  std::size_t backwards = 0;
+  for (auto i = map.end(); i != map.begin(); --i)
+    ++backwards;
+  BOOST_CHECK_EQUAL(backwards, 4);
+  BOOST_CHECK_THROW(--map.begin(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenReserving_ThenNoGrowthHappensUpToReservedCount,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" } };
+  map.max_load_factor(0.5f);
+
+  map.reserve(100);
+  const auto buckets = map.bucket_count();
+  for (int i = 0; i < 100; ++i)
+    map[i] = "x";
+
+  BOOST_CHECK_EQUAL(map.bucket_count(), buckets);
+  BOOST_CHECK(map.bucket_count() >= 200);
+  BOOST_CHECK_THROW(map.max_load_factor(0.0f), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCreated_ThenBucketCountIsPowerOfTwo,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map(1000);
+
+  BOOST_CHECK_EQUAL(map.bucket_count(), 1024);
+  BOOST_CHECK_EQUAL(map.Hash(K{1025}), 1);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMixingHasher_WhenAddingStridedKeys_ThenAllItemsAreInMap,
+                              K,
+                              TestedKeyTypes)
+{
+  aisdi::HashMap<K, std::string, aisdi::MixHash<K>> map(64);
+  std::map<K, std::string> expected;
+
+  for (int i = 0; i < 64; ++i)
+  {
+    map[i * 64] = std::to_string(i);
+    expected[i * 64] = std::to_string(i);
+  }
+
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+  for (const auto& item : expected)
+    BOOST_CHECK_EQUAL(map.valueOf(item.first), item.second);
+}
+
+BOOST_AUTO_TEST_CASE(GivenStringKeys_WhenAddingAndRemovingItems_ThenMapWorks)
+{
+  aisdi::HashMap<std::string, int> map = { { "Alice", 1 }, { "Bob", 2 } };
+
+  map["Chuck"] = 3;
+  map.remove("Alice");
+
+  BOOST_CHECK_EQUAL(map.getSize(), 2);
+  BOOST_CHECK(map.find("Alice") == map.end());
+  BOOST_CHECK_EQUAL(map.valueOf("Bob"), 2);
+  BOOST_CHECK_EQUAL(map.valueOf("Chuck"), 3);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenPooledMap_WhenAddingRemovingAndClearing_ThenMapWorks,
+                              K,
+                              TestedKeyTypes)
+{
+  aisdi::HashMap<K, std::string, std::hash<K>, std::equal_to<K>, aisdi::PooledNodes<16>> map(8);
+
+  for (int i = 0; i < 100; ++i)
+    map[i] = std::to_string(i);
+  for (int i = 0; i < 100; i += 2)
+    map.remove(i);
+  for (int i = 100; i < 150; ++i)
+    map[i] = std::to_string(i);
+
+  BOOST_CHECK_EQUAL(map.getSize(), 100);
+  BOOST_CHECK_EQUAL(map.valueOf(99), "99");
+  BOOST_CHECK_EQUAL(map.valueOf(120), "120");
+  BOOST_CHECK(map.find(98) == map.end());
+
+  auto moved = std::move(map);
+  auto copy = moved;
+  moved.makeEmpty();
+
+  BOOST_CHECK(moved.isEmpty());
+  BOOST_CHECK(moved.begin() == moved.end());
+  BOOST_CHECK_EQUAL(copy.getSize(), 100);
+  BOOST_CHECK_EQUAL(copy.valueOf(149), "149");
+
+  moved[7] = "seven";
+  BOOST_CHECK_EQUAL(moved.valueOf(7), "seven");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenTryEmplacing_ThenExistingValueIsKept,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" } };
+
+  auto inserted = map.try_emplace(27, "Bob");
+  auto existing = map.try_emplace(42, "Chuck");
+
+  BOOST_CHECK(inserted.second);
+  BOOST_CHECK(inserted.first == map.find(27));
+  BOOST_CHECK(!existing.second);
+  BOOST_CHECK_EQUAL(existing.first->second, "Alice");
+  thenMapContainsItems(map, { { 42, "Alice" }, { 27, "Bob" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenInsertingOrAssigning_ThenValueIsReplaced,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" } };
+
+  BOOST_CHECK(!map.insert_or_assign(42, "Chuck").second);
+  BOOST_CHECK(map.insert_or_assign(27, "Bob").second);
+  BOOST_CHECK(map.emplace(13, "Dave").second);
+  BOOST_CHECK(!map.emplace(13, "Eve").second);
+
+  thenMapContainsItems(map, { { 42, "Chuck" }, { 27, "Bob" }, { 13, "Dave" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMissingKey_WhenUsingSubscript_ThenKeyIsCopiedOnce,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  const K key(42);
+
+  OperationCountingObject::resetCounters();
+  map[key] = "Alice";
+  map[key] = "Bob";
+
+  thenCopiedObjectsCountWas<K>(1);
+  thenMovedObjectsCountWas<K>(0);
+  thenMapContainsItems(map, { { 42, "Bob" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMovedKey_WhenTryEmplacingOrEmplacing_ThenNoKeyIsCopied,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  K key(42);
+
+  OperationCountingObject::resetCounters();
+  map.try_emplace(std::move(key), "Alice");
+  map.emplace(std::piecewise_construct, std::forward_as_tuple(27), std::forward_as_tuple("Bob"));
+
+  thenCopiedObjectsCountWas<K>(0);
+  thenMovedObjectsCountWas<K>(1);
+  thenMapContainsItems(map, { { 42, "Alice" }, { 27, "Bob" } });
+}
+
+BOOST_AUTO_TEST_CASE(GivenRvalueItem_WhenInsertingB_ThenValueIsMovedNotCopied)
+{
+  aisdi::HashMap<int, OperationCountingObject> map;
+  std::pair<const int, OperationCountingObject> item(1, 27);
+  const std::pair<const int, OperationCountingObject> other(2, 42);
+
+  OperationCountingObject::resetCounters();
+  map.insertB(std::move(item));
+  BOOST_CHECK_EQUAL(OperationCountingObject::copiedObjectsCount(), 0);
+  BOOST_CHECK_EQUAL(OperationCountingObject::movedObjectsCount(), 1);
+
+  map.insertB(other);
+  BOOST_CHECK_EQUAL(OperationCountingObject::copiedObjectsCount(), 1);
+  BOOST_CHECK_EQUAL(map.valueOf(1), 27);
+  BOOST_CHECK_EQUAL(map.valueOf(2), 42);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapDuringRehash_WhenFindingManyKeys_ThenEachKeyGetsItsItemOrEnd,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(8);
+  for (int i = 0; i < 40; ++i)
+    map[i] = std::to_string(i);
+
+  std::vector<K> keys;
+  for (int i = 0; i < 50; ++i)
+    keys.push_back(K(i * 7 % 50));
+  std::vector<typename Map<K>::iterator> found(keys.size());
+  std::vector<typename Map<K>::const_iterator> constFound(keys.size());
+
+  BOOST_CHECK_EQUAL(map.findMany(keys.data(), keys.size(), found.data()), 40);
+  const auto& constMap = map;
+  BOOST_CHECK_EQUAL(constMap.findMany(keys.data(), keys.size(), constFound.data()), 40);
+
+  for (std::size_t i = 0; i < keys.size(); ++i)
+  {
+    BOOST_CHECK(found[i] == map.find(keys[i]));
+    BOOST_CHECK(constFound[i] == map.find(keys[i]));
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenInsertingMany_ThenExistingAndRepeatedKeysKeepFirstValue,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(4);
+  map[1] = "Alice";
+
+  std::vector<typename Map<K>::value_type> items;
+  std::map<K, std::string> expected = { { 1, "Alice" } };
+  for (int i = 0; i < 100; ++i)
+  {
+    items.emplace_back(K(i % 60), "v" + std::to_string(i));
+    expected.emplace(K(i % 60), "v" + std::to_string(i));
+  }
+
+  BOOST_CHECK_EQUAL(map.insertMany(items.data(), items.size()), 59);
+  BOOST_CHECK(map.load_factor() <= map.max_load_factor());
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenTakingStats_ThenChainLengthsAreReported,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(8);
+  map.max_load_factor(4.0f);
+  for (int i = 0; i < 6; ++i)
+    map[i * 8] = "x";
+  map[1] = "x";
+  map[2] = "x";
+  map[10] = "x";
+
+  const aisdi::HashMapStats stats = map.stats();
+
+  BOOST_CHECK_EQUAL(stats.size, 9);
+  BOOST_CHECK_EQUAL(stats.bucketCount, 8);
+  BOOST_CHECK_CLOSE(stats.loadFactor, 9.0f / 8, 0.001);
+  BOOST_CHECK_EQUAL(stats.maxChain, 6);
+  BOOST_CHECK_EQUAL(stats.p99Chain, 6);
+  BOOST_CHECK_CLOSE(stats.meanChain, 3.0, 0.001);
+  BOOST_CHECK_CLOSE(stats.emptyBucketRatio, 5.0 / 8, 0.001);
+  const std::vector<std::size_t> histogram = { 5, 1, 1, 0, 0, 0, 1 };
+  BOOST_CHECK(stats.chainHistogram == histogram);
+}
+
+BOOST_AUTO_TEST_CASE(GivenEmptyMap_WhenTakingStats_ThenEveryBucketIsEmpty)
+{
+  const Map<int> map(16);
+
+  const aisdi::HashMapStats stats = map.stats();
+
+  BOOST_CHECK_EQUAL(stats.maxChain, 0);
+  BOOST_CHECK_EQUAL(stats.p99Chain, 0);
+  BOOST_CHECK_EQUAL(stats.meanChain, 0.0);
+  BOOST_CHECK_EQUAL(stats.emptyBucketRatio, 1.0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenAddingItems_ThenMemoryUsageGrowsByNodes,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(16);
+  const aisdi::MemoryUsage empty = map.memory_usage();
+  BOOST_CHECK_EQUAL(empty.bucketBytes, 0);
+  BOOST_CHECK_EQUAL(empty.nodeBytes, 0);
+  BOOST_CHECK_EQUAL(empty.payloadBytes, 0);
+  BOOST_CHECK_EQUAL(empty.total(), sizeof(map));
+
+  map[1] = "a";
+  map[2] = "b";
+  map[3] = "c";
+  const aisdi::MemoryUsage used = map.memory_usage();
+  using value_type = typename Map<K>::value_type;
+  BOOST_CHECK_EQUAL(used.bucketBytes, 0);
+  BOOST_CHECK_EQUAL(used.payloadBytes, 3 * sizeof(value_type));
+  BOOST_CHECK_EQUAL(used.nodeBytes % 3, 0);
+  BOOST_CHECK(used.nodeBytes / 3 > sizeof(value_type));
+  BOOST_CHECK(used.overheadBytes > empty.overheadBytes);
+
+  for (int i = 4; i < 10; ++i)
+    map[i] = "x";
+  BOOST_CHECK_EQUAL(map.memory_usage().bucketBytes,
+                    16 * sizeof(void*) + 16 * sizeof(std::size_t) + sizeof(std::uint64_t));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSmallMap_WhenRemovingAndAdding_ThenIteratorsToOtherItemsStayValid,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 6; ++i)
+    map[i] = std::to_string(i);
+
+  auto second = map.begin();
+  ++second;
+  const K secondKey = second->first;
+  map.remove(map.begin());
+  map[42] = "x";
+
+  std::size_t forwards = 0;
+  for (auto it = second; it != map.end(); ++it)
+    ++forwards;
+  std::size_t backwards = 0;
+  for (auto it = map.end(); it != map.begin(); --it)
+    ++backwards;
+
+  BOOST_CHECK(second->first == secondKey);
+  BOOST_CHECK_EQUAL(backwards, 6);
+  BOOST_CHECK(forwards >= 5);
+  BOOST_CHECK_EQUAL(map.memory_usage().bucketBytes, 0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSmallMap_WhenMoving_ThenSourceIsEmptyAndUsable,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
+
+  OperationCountingObject::resetCounters();
+  Map<K> other = std::move(map);
+  thenConstructedObjectsCountWas<K>(0);
+  thenMovedObjectsCountWas<K>(0);
+
+  thenMapContainsItems(other, { { 753, "Rome" }, { 1789, "Paris" } });
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  for (int i = 0; i < 20; ++i)
+    map[i] = "x";
+  BOOST_CHECK_EQUAL(map.getSize(), 20);
+}
+
+BOOST_AUTO_TEST_CASE(GivenProbeCountingMap_WhenOperating_ThenProbesAreCountedPerOperation)
+{
+  using Counting = aisdi::HashMap<int, std::string, std::hash<int>, std::equal_to<int>,
+                                  aisdi::HeapNodes, aisdi::ProbeCounting>;
+  using aisdi::MapOperation;
+  Counting map(8);
+  map.rehash(8);
+  map[0] = "a";
+  map[8] = "b";
+  map[16] = "c";
+
+  map.instrumentation().reset();
+  BOOST_CHECK(map.contains(0));
+  BOOST_CHECK(map.find(99) == map.end());
+  map[16] = "d";
+  map.remove(8);
+
+  const auto& probes = map.instrumentation();
+  BOOST_CHECK_EQUAL(probes[MapOperation::find].calls, 2);
+  BOOST_CHECK_EQUAL(probes[MapOperation::find].probes, 3);
+  BOOST_CHECK_EQUAL(probes[MapOperation::find].maxProbes, 3);
+  BOOST_CHECK_EQUAL(probes[MapOperation::insert].calls, 1);
+  BOOST_CHECK_EQUAL(probes[MapOperation::insert].probes, 1);
+  BOOST_CHECK_EQUAL(probes[MapOperation::remove].calls, 1);
+  BOOST_CHECK_EQUAL(probes[MapOperation::remove].probes, 2);
+  BOOST_CHECK_CLOSE(probes[MapOperation::find].meanProbes(), 1.5, 0.001);
+}
+
+BOOST_AUTO_TEST_CASE(GivenProbeCountingMap_WhenErasingByIterator_ThenNoChainIsWalked)
+{
+  using Counting = aisdi::HashMap<int, std::string, std::hash<int>, std::equal_to<int>,
+                                  aisdi::HeapNodes, aisdi::ProbeCounting>;
+  using aisdi::MapOperation;
+  Counting map(8);
+  map.rehash(8);
+  map[0] = "a";
+  map[8] = "b";
+  map[16] = "c";
+
+  auto it = map.find(8);
+  map.instrumentation().reset();
+  auto next = map.erase(it);
+
+  BOOST_CHECK_EQUAL(map.instrumentation()[MapOperation::remove].calls, 0);
+  BOOST_CHECK_EQUAL(next->first, 0);
+  BOOST_CHECK(!map.contains(8));
+  BOOST_CHECK_EQUAL(map.getSize(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(GivenTransparentStringMap_WhenLookingUpByStringView_ThenItemsAreFound)
+{
+  aisdi::HashMap<std::string, int, aisdi::StringHash, std::equal_to<>> map = { { "Alice", 1 }, { "Bob", 2 } };
+  const std::string buffer = "Alice,Bob,Chuck";
+  const std::string_view alice(buffer.data(), 5);
+  const std::string_view chuck(buffer.data() + 10, 5);
+
+  BOOST_CHECK(map.contains(alice));
+  BOOST_CHECK(!map.contains(chuck));
+  BOOST_CHECK(map.find(alice) == map.find("Alice"));
+  BOOST_CHECK(map.find(chuck) == map.end());
+  BOOST_CHECK_EQUAL(map.valueOf(std::string_view(buffer.data() + 6, 3)), 2);
+  BOOST_CHECK_THROW(map.valueOf(chuck), std::out_of_range);
+
+  map.remove(alice);
+  BOOST_CHECK_THROW(map.remove(alice), std::out_of_range);
+  BOOST_CHECK_EQUAL(map.getSize(), 1);
+}
+
+struct TransparentIntHash
+{
+  using is_transparent = void;
+
+  std::size_t operator()(int x) const
+  {
+    return std::hash<int>()(x);
+  }
+};
+
+BOOST_AUTO_TEST_CASE(GivenTransparentMap_WhenLookingUpByCompatibleKey_ThenNoKeyIsConstructed)
+{
+  aisdi::HashMap<OperationCountingObject, std::string, TransparentIntHash, std::equal_to<>> map;
+  map[42] = "Alice";
+  map[27] = "Bob";
+
+  OperationCountingObject::resetCounters();
+  BOOST_CHECK(map.contains(42));
+  BOOST_CHECK(map.find(27) != map.end());
+  BOOST_CHECK_EQUAL(map.valueOf(42), "Alice");
+  map.remove(27);
+
+  thenConstructedObjectsCountWas<OperationCountingObject>(0);
+  BOOST_CHECK(!map.contains(27));
+}
+
+// ConstIterator is tested via Iterator methods.
+// If Iterator methods are to be changed, then new ConstIterator tests are required.
+
+BOOST_AUTO_TEST_SUITE_END()
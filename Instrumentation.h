@@ -0,0 +1,331 @@
+#ifndef AISDI_MAPS_INSTRUMENTATION_H
+#define AISDI_MAPS_INSTRUMENTATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace aisdi
+{
+
+/*
+  Instrumentation policies for HashMap and TreeMap. A policy gets three
+  kinds of events:
+  - probed(op, probes): a HashMap key search done for op compared keys
+    of `probes` nodes,
+  - Scope(policy, op): an object living for the duration of one public
+    operation (find, insert, remove, operator[], iterator step),
+  - rotated(): TreeMap did one single rotation.
+  NoInstrumentation is the default and compiles away. ProbeCounting keeps
+  per-map probe totals, LatencyRecording per-thread counts and latency
+  histograms that are summed up on demand.
+*/
+
+enum class MapOperation
+{
+  find,
+  insert,
+  remove,
+  subscript,
+  iterate
+};
+
+static const std::size_t mapOperationCount = 5;
+
+struct NoInstrumentation
+{
+  static const bool enabled = false;
+
+  void probed(MapOperation, std::size_t) {}
+
+  void rotated() {}
+
+  class Scope
+  {
+  public:
+    Scope(const NoInstrumentation&, MapOperation) {}
+  };
+};
+
+/* counts are plain integers: a map shared between threads needs its own synchronization */
+class ProbeCounting : public NoInstrumentation
+{
+public:
+  static const bool enabled = true;
+
+  struct Counter
+  {
+    std::size_t calls;
+    std::size_t probes;
+    std::size_t maxProbes;
+
+    double meanProbes() const
+    {
+      return calls == 0 ? 0.0 : static_cast<double>(probes) / calls;
+    }
+  };
+
+  ProbeCounting()
+  {
+    reset();
+  }
+
+  void probed(MapOperation op, std::size_t probes)
+  {
+    Counter& c = counters[static_cast<std::size_t>(op)];
+    ++c.calls;
+    c.probes += probes;
+    if(probes > c.maxProbes)
+      c.maxProbes = probes;
+  }
+
+  const Counter& operator[](MapOperation op) const
+  {
+    return counters[static_cast<std::size_t>(op)];
+  }
+
+  void reset()
+  {
+    for(auto& c : counters)
+      c = Counter{ 0, 0, 0 };
+  }
+
+private:
+  Counter counters[mapOperationCount];
+};
+
+/* LatencyRecording totals, see LatencyRecording::snapshot() */
+struct LatencySnapshot
+{
+  /* bucket b counts operations that took [2^(b-1), 2^b) ns, bucket 0 those under 1 ns */
+  static const std::size_t buckets = 40;
+
+  struct Operation
+  {
+    std::uint64_t calls;
+    std::uint64_t probes;
+    std::uint64_t totalNs;
+    std::uint64_t histogram[buckets];
+
+    double meanNs() const
+    {
+      return calls == 0 ? 0.0 : static_cast<double>(totalNs) / calls;
+    }
+
+    /* upper bound of the bucket holding the given fraction (e.g. 0.99) of the calls */
+    std::uint64_t percentileNs(double fraction) const
+    {
+      std::uint64_t seen = 0;
+      for(std::size_t b = 0; b < buckets; ++b)
+      {
+        seen += histogram[b];
+        if(calls != 0 && seen >= fraction * calls)
+          return std::uint64_t(1) << b;
+      }
+      return 0;
+    }
+  };
+
+  Operation operations[mapOperationCount];
+  std::uint64_t rotations;
+
+  const Operation& operator[](MapOperation op) const
+  {
+    return operations[static_cast<std::size_t>(op)];
+  }
+};
+
+/*
+  Counts and times operations of every map that uses it, in this thread's
+  own counters, so recording takes no lock and no atomic increment. Maps
+  that should be reported apart use a different Tag. snapshot() sums up
+  the counters of all threads, including ones that already exited.
+*/
+template <typename Tag = void>
+class LatencyRecording : public NoInstrumentation
+{
+  using Clock = std::chrono::steady_clock;
+  static const std::size_t buckets = LatencySnapshot::buckets;
+
+  /* written by the owning thread only; atomics just let snapshot() read them meanwhile */
+  struct ThreadCounters
+  {
+    std::atomic<std::uint64_t> calls[mapOperationCount];
+    std::atomic<std::uint64_t> probes[mapOperationCount];
+    std::atomic<std::uint64_t> totalNs[mapOperationCount];
+    std::atomic<std::uint64_t> histogram[mapOperationCount][buckets];
+    std::atomic<std::uint64_t> rotations;
+
+    ThreadCounters()
+    {
+      clear();
+    }
+
+    void clear()
+    {
+      for(std::size_t op = 0; op < mapOperationCount; ++op)
+      {
+        calls[op].store(0, std::memory_order_relaxed);
+        probes[op].store(0, std::memory_order_relaxed);
+        totalNs[op].store(0, std::memory_order_relaxed);
+        for(std::size_t b = 0; b < buckets; ++b)
+          histogram[op][b].store(0, std::memory_order_relaxed);
+      }
+      rotations.store(0, std::memory_order_relaxed);
+    }
+
+    void addTo(LatencySnapshot& total) const
+    {
+      for(std::size_t op = 0; op < mapOperationCount; ++op)
+      {
+        LatencySnapshot::Operation& o = total.operations[op];
+        o.calls += calls[op].load(std::memory_order_relaxed);
+        o.probes += probes[op].load(std::memory_order_relaxed);
+        o.totalNs += totalNs[op].load(std::memory_order_relaxed);
+        for(std::size_t b = 0; b < buckets; ++b)
+          o.histogram[b] += histogram[op][b].load(std::memory_order_relaxed);
+      }
+      total.rotations += rotations.load(std::memory_order_relaxed);
+    }
+  };
+
+  struct Registry
+  {
+    std::mutex lock;
+    std::vector<ThreadCounters*> threads;
+    LatencySnapshot exited;
+
+    Registry()
+      :exited() {}
+  };
+
+  /* registers this thread's counters on first use, folds them into Registry::exited at thread exit */
+  struct ThreadSlot
+  {
+    ThreadCounters counters;
+
+    ThreadSlot()
+    {
+      Registry& r = registry();
+      std::lock_guard<std::mutex> guard(r.lock);
+      r.threads.push_back(&counters);
+    }
+
+    ~ThreadSlot()
+    {
+      Registry& r = registry();
+      std::lock_guard<std::mutex> guard(r.lock);
+      counters.addTo(r.exited);
+      for(std::size_t i = 0; i < r.threads.size(); ++i)
+      {
+        if(r.threads[i] == &counters)
+        {
+          r.threads[i] = r.threads.back();
+          r.threads.pop_back();
+          break;
+        }
+      }
+    }
+  };
+
+  static Registry& registry()
+  {
+    static Registry r;
+    return r;
+  }
+
+  static ThreadCounters& local()
+  {
+    static thread_local ThreadSlot slot;
+    return slot.counters;
+  }
+
+  /* single writer, so no read-modify-write instruction is needed */
+  static void bump(std::atomic<std::uint64_t>& counter, std::uint64_t by)
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+  }
+
+  static std::size_t bucketOf(std::uint64_t ns)
+  {
+    std::size_t b = 0;
+    while(ns != 0 && b + 1 < buckets)
+    {
+      ns >>= 1;
+      ++b;
+    }
+    return b;
+  }
+
+public:
+  void probed(MapOperation op, std::size_t probes)
+  {
+    bump(local().probes[static_cast<std::size_t>(op)], probes);
+  }
+
+  void rotated()
+  {
+    bump(local().rotations, 1);
+  }
+
+  class Scope
+  {
+  public:
+    Scope(const LatencyRecording&, MapOperation op_)
+      :op(static_cast<std::size_t>(op_)), start(Clock::now()) {}
+
+    ~Scope()
+    {
+      std::uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+      ThreadCounters& c = local();
+      bump(c.calls[op], 1);
+      bump(c.totalNs[op], ns);
+      bump(c.histogram[op][bucketOf(ns)], 1);
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    std::size_t op;
+    Clock::time_point start;
+  };
+
+  static LatencySnapshot snapshot()
+  {
+    LatencySnapshot total = LatencySnapshot();
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    for(ThreadCounters *c : r.threads)
+      c->addTo(total);
+
+    const LatencySnapshot& e = r.exited;
+    for(std::size_t op = 0; op < mapOperationCount; ++op)
+    {
+      total.operations[op].calls += e.operations[op].calls;
+      total.operations[op].probes += e.operations[op].probes;
+      total.operations[op].totalNs += e.operations[op].totalNs;
+      for(std::size_t b = 0; b < buckets; ++b)
+        total.operations[op].histogram[b] += e.operations[op].histogram[b];
+    }
+    total.rotations += e.rotations;
+    return total;
+  }
+
+  /* counts of threads that record meanwhile may survive the reset in part */
+  static void reset()
+  {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    for(ThreadCounters *c : r.threads)
+      c->clear();
+    r.exited = LatencySnapshot();
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_INSTRUMENTATION_H */
@@ -0,0 +1,151 @@
+#include <Instrumentation.h>
+#include <HashMap.h>
+#include <TreeMap.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+
+struct HashMapTag {};
+struct TreeMapTag {};
+struct ThreadTag {};
+
+using aisdi::MapOperation;
+
+using RecordingHashMap = aisdi::HashMap<int, std::string, std::hash<int>, std::equal_to<int>,
+                                        aisdi::HeapNodes, aisdi::LatencyRecording<HashMapTag>>;
+using RecordingTreeMap = aisdi::TreeMap<int, std::string, std::less<int>,
+                                        aisdi::HeapNodes, aisdi::LatencyRecording<TreeMapTag>>;
+
+std::uint64_t histogramTotal(const aisdi::LatencySnapshot::Operation& op)
+{
+  std::uint64_t total = 0;
+  for(std::size_t b = 0; b < aisdi::LatencySnapshot::buckets; ++b)
+    total += op.histogram[b];
+  return total;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(InstrumentationTests)
+
+BOOST_AUTO_TEST_CASE(GivenRecordingPolicy_WhenUsedByMap_ThenMapKeepsItsSize)
+{
+  BOOST_CHECK(std::is_empty<aisdi::LatencyRecording<HashMapTag>>::value);
+  BOOST_CHECK_EQUAL(sizeof(RecordingHashMap), (sizeof(aisdi::HashMap<int, std::string>)));
+  BOOST_CHECK_EQUAL(sizeof(RecordingTreeMap), (sizeof(aisdi::TreeMap<int, std::string>)));
+}
+
+BOOST_AUTO_TEST_CASE(GivenRecordingHashMap_WhenOperating_ThenEveryOperationIsCountedAndTimed)
+{
+  using Recording = aisdi::LatencyRecording<HashMapTag>;
+  RecordingHashMap map(8);
+  map[0] = "a";
+  map[8] = "b";
+  map[16] = "c";
+
+  Recording::reset();
+  BOOST_CHECK(map.contains(0));
+  BOOST_CHECK(map.find(99) == map.end());
+  BOOST_CHECK_EQUAL(map.valueOf(8), "b");
+  map.try_emplace(24, "d");
+  map[16] = "e";
+  map.remove(8);
+  std::size_t seen = 0;
+  for(auto it = map.begin(); it != map.end(); ++it)
+    ++seen;
+
+  aisdi::LatencySnapshot snapshot = Recording::snapshot();
+  BOOST_CHECK_EQUAL(snapshot[MapOperation::find].calls, 3);
+  BOOST_CHECK_EQUAL(snapshot[MapOperation::insert].calls, 1);
+  BOOST_CHECK_EQUAL(snapshot[MapOperation::subscript].calls, 1);
+  BOOST_CHECK_EQUAL(snapshot[MapOperation::remove].calls, 1);
+  BOOST_CHECK_EQUAL(snapshot[MapOperation::iterate].calls, seen);
+  BOOST_CHECK_EQUAL(snapshot.rotations, 0);
+  for(const auto& op : snapshot.operations)
+    BOOST_CHECK_EQUAL(histogramTotal(op), op.calls);
+  BOOST_CHECK(snapshot[MapOperation::find].probes >= 2);
+  BOOST_CHECK(snapshot[MapOperation::find].percentileNs(0.5) <= snapshot[MapOperation::find].percentileNs(1.0));
+}
+
+BOOST_AUTO_TEST_CASE(GivenRecordingHashMap_WhenWorkingInBatches_ThenEveryBatchIsOneOperation)
+{
+  using Recording = aisdi::LatencyRecording<HashMapTag>;
+  RecordingHashMap map;
+  std::vector<RecordingHashMap::value_type> items;
+  std::vector<int> keys;
+  for(int i = 0; i < 40; ++i)
+  {
+    items.emplace_back(i, "x");
+    keys.push_back(i * 2);
+  }
+
+  Recording::reset();
+  BOOST_CHECK_EQUAL(map.insertMany(items.data(), items.size()), 40);
+  std::vector<RecordingHashMap::const_iterator> found(keys.size());
+  BOOST_CHECK_EQUAL(static_cast<const RecordingHashMap&>(map).findMany(keys.data(), keys.size(), found.data()), 20);
+  std::vector<RecordingHashMap::iterator> foundMutable(keys.size());
+  BOOST_CHECK_EQUAL(map.findMany(keys.data(), keys.size(), foundMutable.data()), 20);
+
+  aisdi::LatencySnapshot snapshot = Recording::snapshot();
+  BOOST_CHECK_EQUAL(snapshot[MapOperation::insert].calls, 1);
+  BOOST_CHECK_EQUAL(snapshot[MapOperation::find].calls, 2);
+  BOOST_CHECK(snapshot[MapOperation::find].probes >= 40);
+}
+
+BOOST_AUTO_TEST_CASE(GivenRecordingTreeMap_WhenAddingAscendingKeys_ThenRotationsAreCounted)
+{
+  using Recording = aisdi::LatencyRecording<TreeMapTag>;
+  RecordingTreeMap map;
+
+  Recording::reset();
+  map[1] = "a";
+  map[2] = "b";
+  map.try_emplace(3, "c");
+  map[3] = "d";
+  BOOST_CHECK(map.contains(2));
+  map.remove(1);
+  for(auto it = map.begin(); it != map.end(); ++it)
+    ;
+
+  aisdi::LatencySnapshot snapshot = Recording::snapshot();
+  BOOST_CHECK_EQUAL(snapshot.rotations, 1);
+  BOOST_CHECK_EQUAL(snapshot[MapOperation::subscript].calls, 3);
+  BOOST_CHECK_EQUAL(snapshot[MapOperation::insert].calls, 1);
+  BOOST_CHECK_EQUAL(snapshot[MapOperation::find].calls, 1);
+  BOOST_CHECK_EQUAL(snapshot[MapOperation::remove].calls, 1);
+  BOOST_CHECK_EQUAL(snapshot[MapOperation::iterate].calls, 2);
+}
+
+BOOST_AUTO_TEST_CASE(GivenThreadThatExited_WhenTakingSnapshot_ThenItsCountsAreIncluded)
+{
+  using Recording = aisdi::LatencyRecording<ThreadTag>;
+  using Map = aisdi::HashMap<int, int, std::hash<int>, std::equal_to<int>, aisdi::HeapNodes, Recording>;
+  Recording::reset();
+
+  std::thread worker([] {
+    Map map;
+    for(int i = 0; i < 100; ++i)
+      map.try_emplace(i, i);
+  });
+  worker.join();
+
+  Map map;
+  map.try_emplace(0, 0);
+
+  aisdi::LatencySnapshot snapshot = Recording::snapshot();
+  BOOST_CHECK_EQUAL(snapshot[MapOperation::insert].calls, 101);
+  BOOST_CHECK_EQUAL(histogramTotal(snapshot[MapOperation::insert]), 101);
+
+  Recording::reset();
+  BOOST_CHECK_EQUAL(Recording::snapshot()[MapOperation::insert].calls, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
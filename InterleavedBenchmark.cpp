@@ -0,0 +1,97 @@
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+
+#include "InterleavedLookup.h"
+
+#include <iostream>
+#include <chrono>
+#include <vector>
+
+
+using us = std::chrono::microseconds;
+using get_time = std::chrono::steady_clock;
+using size_type = std::size_t;
+using string = std::string;
+
+/* keeps the optimizer from dropping lookups whose result is unused */
+volatile size_type sink;
+
+/* half of the keys hit, in scattered order so consecutive lookups share no path */
+std::vector<int> scatteredKeys(size_type number_of_elements, size_type count)
+{
+  std::vector<int> keys;
+  for(size_type i = 0; i < count; ++i)
+    keys.push_back(static_cast<int>(i * 2654435761u % (2 * number_of_elements)));
+  return keys;
+}
+
+template <typename Map>
+us testFindLoop(const Map& map, const std::vector<int>& keys)
+{
+  auto start = get_time::now();
+
+  size_type found = 0;
+  for(int key : keys)
+    found += map.contains(key);
+  sink = found;
+  return std::chrono::duration_cast<us>(get_time::now() - start);
+}
+
+/* keys go to findInterleaved in request-sized batches */
+template <typename Map>
+us testFindInterleaved(const Map& map, const std::vector<int>& keys, size_type inFlight)
+{
+  const size_type batch = 256;
+  std::vector<typename Map::const_iterator> out(batch);
+
+  auto start = get_time::now();
+
+  size_type found = 0;
+  for(size_type base = 0; base + batch <= keys.size(); base += batch)
+    found += aisdi::findInterleaved(map, &keys[base], batch, out.data(), inFlight);
+  sink = found;
+  return std::chrono::duration_cast<us>(get_time::now() - start);
+}
+
+void report(const char* name, us time)
+{
+  std::cout << name << ": " << time.count() << " us\n";
+}
+
+template <typename Map>
+void compare(const Map& map, const std::vector<int>& keys)
+{
+  report("find loop", testFindLoop(map, keys));
+  for(size_type inFlight : { 4, 8, 12, 16, 24 })
+  {
+    std::cout << "interleaved, " << inFlight << " in flight: ";
+    std::cout << testFindInterleaved(map, keys, inFlight).count() << " us\n";
+  }
+  std::cout << "\n";
+}
+
+int main(int argc, char** argv)
+{
+  /* 4M nodes of TreeMap<int, string> take ~300 MB, well beyond a typical LLC */
+  const size_type treeSize = argc > 1 ? std::atoll(argv[1]) : 4000000;
+  const size_type lookups = argc > 2 ? std::atoll(argv[2]) : 1000000;
+  const std::vector<int> keys = scatteredKeys(treeSize, lookups);
+
+  {
+    aisdi::TreeMap<int, string> tree;
+    tree.insertForTest(treeSize);
+    std::cout << "TreeMap, " << treeSize << " items, " << lookups << " lookups\n";
+    compare(tree, keys);
+  }
+
+  {
+    aisdi::HashMap<int, string, aisdi::MixHash<int>> map(treeSize);
+    for(size_type i = 0; i < treeSize; ++i)
+      map.insertB(std::pair<const int, string>(i, "Item"));
+    std::cout << "HashMap, " << treeSize << " items, " << lookups << " lookups\n";
+    compare(map, keys);
+  }
+
+  return 0;
+}
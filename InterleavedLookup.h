@@ -0,0 +1,329 @@
+#ifndef AISDI_MAPS_INTERLEAVEDLOOKUP_H
+#define AISDI_MAPS_INTERLEAVEDLOOKUP_H
+
+#if !defined(__cpp_impl_coroutine)
+#error "InterleavedLookup.h needs C++20 coroutines (-std=c++20, plus -fcoroutines on GCC 10)"
+#endif
+
+#include <cstddef>
+#include <coroutine>
+#include <exception>
+#include <new>
+#include <utility>
+
+#include "TreeMap.h"
+#include "HashMap.h"
+
+namespace aisdi
+{
+
+/*
+  Interleaved lookups. Every step of a tree descent or chain walk depends
+  on the node loaded by the previous one, so one lookup cannot overlap its
+  own cache misses. Here each lookup is a coroutine that prefetches the
+  node it is about to read and suspends; the scheduler meanwhile resumes
+  the other lookups in flight, and by the time it gets back the node is
+  (ideally) in cache. With enough lookups in flight the misses of
+  different keys overlap.
+
+  The maps stay C++17; only this header needs coroutine support.
+*/
+
+namespace interleaved
+{
+
+/*
+  Coroutine frames of one lookup kind all have the same size, so freed
+  frames are kept per thread and reused: a lookup does not pay for a
+  heap allocation.
+*/
+class FrameCache
+{
+  static const std::size_t capacity = 64;
+
+  void *frames[capacity];
+  std::size_t count;
+  std::size_t frameSize;
+
+public:
+  FrameCache()
+    :count(0), frameSize(0) {}
+
+  ~FrameCache()
+  {
+    while(count > 0)
+      ::operator delete(frames[--count]);
+  }
+
+  void *allocate(std::size_t size)
+  {
+    if(size == frameSize && count > 0)
+      return frames[--count];
+    return ::operator new(size);
+  }
+
+  void deallocate(void *frame, std::size_t size)
+  {
+    if(size != frameSize)
+    {
+      /* a different kind of lookup: start caching its frames instead */
+      while(count > 0)
+        ::operator delete(frames[--count]);
+      frameSize = size;
+    }
+    if(count < capacity)
+      frames[count++] = frame;
+    else
+      ::operator delete(frame);
+  }
+
+  static FrameCache& local()
+  {
+    static thread_local FrameCache cache;
+    return cache;
+  }
+};
+
+/* one lookup; starts suspended and is driven by run() */
+class Lookup
+{
+public:
+  struct promise_type
+  {
+    std::exception_ptr error;
+
+    Lookup get_return_object()
+    {
+      return Lookup(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+
+    void unhandled_exception()
+    {
+      error = std::current_exception();
+    }
+
+    static void *operator new(std::size_t size)
+    {
+      return FrameCache::local().allocate(size);
+    }
+
+    static void operator delete(void *frame, std::size_t size)
+    {
+      FrameCache::local().deallocate(frame, size);
+    }
+  };
+
+  Lookup()
+    :handle(nullptr) {}
+
+  explicit Lookup(std::coroutine_handle<promise_type> h)
+    :handle(h) {}
+
+  Lookup(Lookup&& other)
+    :handle(other.handle)
+  {
+    other.handle = nullptr;
+  }
+
+  Lookup& operator=(Lookup&& other)
+  {
+    std::swap(handle, other.handle);
+    return *this;
+  }
+
+  Lookup(const Lookup&) = delete;
+  Lookup& operator=(const Lookup&) = delete;
+
+  ~Lookup()
+  {
+    if(handle)
+      handle.destroy();
+  }
+
+  /* runs to the next suspension point, false once the lookup is finished */
+  bool step()
+  {
+    handle.resume();
+    if(!handle.done())
+      return true;
+    if(handle.promise().error)
+      std::rethrow_exception(handle.promise().error);
+    return false;
+  }
+
+private:
+  std::coroutine_handle<promise_type> handle;
+};
+
+/* co_await prefetch(p): starts loading p into cache and lets other lookups run */
+struct Prefetch
+{
+  const void *address;
+
+  bool await_ready() const noexcept
+  {
+    return false;
+  }
+
+  void await_suspend(std::coroutine_handle<>) const noexcept
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#endif
+  }
+
+  void await_resume() const noexcept {}
+};
+
+inline Prefetch prefetch(const void *address)
+{
+  return Prefetch{ address };
+}
+
+/*
+  Runs start(0) .. start(count - 1), keeping up to inFlight of them
+  interleaved round-robin. A finished lookup frees its slot for the next.
+*/
+template <typename StartLookup>
+void run(std::size_t count, std::size_t inFlight, StartLookup start)
+{
+  static const std::size_t maxInFlight = 32;
+  if(inFlight == 0)
+    inFlight = 1;
+  if(inFlight > maxInFlight)
+    inFlight = maxInFlight;
+
+  Lookup slots[maxInFlight];
+  std::size_t next = 0;
+  std::size_t active = 0;
+  for(; active < inFlight && next < count; ++active)
+    slots[active] = start(next++);
+
+  while(active > 0)
+  {
+    for(std::size_t i = 0; i < active; )
+    {
+      if(slots[i].step())
+      {
+        ++i;
+        continue;
+      }
+      if(next < count)
+      {
+        slots[i] = start(next++);
+        ++i;
+      }
+      else
+      {
+        slots[i] = std::move(slots[--active]);
+      }
+    }
+  }
+}
+
+}
+
+template <typename KeyType, typename ValueType, typename Compare, typename NodePolicy, typename Instrumentation>
+struct LookupAccess<TreeMap<KeyType, ValueType, Compare, NodePolicy, Instrumentation>>
+{
+  using Map = TreeMap<KeyType, ValueType, Compare, NodePolicy, Instrumentation>;
+  using Node = typename Map::Node;
+
+  /* the descent of findN, suspending before every node it reads */
+  template <typename K>
+  static interleaved::Lookup find(const Map& map, const K& key, typename Map::const_iterator& out)
+  {
+    Node *t = map.root;
+    while(t != nullptr && t != map.last)
+    {
+      co_await interleaved::prefetch(t);
+      if(map.comp(key, t->data.first))
+        t = t->left;
+      else if(map.comp(t->data.first, key))
+        t = t->right;
+      else
+        break;
+    }
+    out = map.makeIterator(t == map.last ? nullptr : t);
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Hasher, typename KeyEqual, typename NodePolicy, typename Instrumentation>
+struct LookupAccess<HashMap<KeyType, ValueType, Hasher, KeyEqual, NodePolicy, Instrumentation>>
+{
+  using Map = HashMap<KeyType, ValueType, Hasher, KeyEqual, NodePolicy, Instrumentation>;
+  using Node = typename Map::Node;
+  using size_type = typename Map::size_type;
+
+  /* findNode with a suspension before the bucket slot and before every node */
+  template <typename K>
+  static interleaved::Lookup find(const Map& map, const K& key, typename Map::const_iterator& out)
+  {
+    size_type code = map.hasher(key);
+    if(map.head == nullptr)
+    {
+      /* small mode: the slots are part of the map, there is nothing to prefetch */
+      size_type pos;
+      Node *t = map.findSmall(key, code, pos, MapOperation::find);
+      out = t == nullptr ? map.cend() : map.makeIterator(t, pos);
+      co_return;
+    }
+    if(map.oldHead != nullptr && (code & (map.oldSize - 1)) >= map.rehashIndex)
+    {
+      size_type oldIndex = code & (map.oldSize - 1);
+      co_await interleaved::prefetch(&map.oldHead[oldIndex]);
+      for(Node *t = map.oldHead[oldIndex]; t != nullptr; t = t->next)
+      {
+        co_await interleaved::prefetch(t);
+        if(map.equal(t->data.first, key))
+        {
+          out = map.makeIterator(t, oldIndex);
+          co_return;
+        }
+      }
+    }
+
+    size_type keyIndex = code & (map.Size - 1);
+    co_await interleaved::prefetch(&map.head[keyIndex]);
+    for(Node *t = map.head[keyIndex]; t != nullptr; t = t->next)
+    {
+      co_await interleaved::prefetch(t);
+      if(map.equal(t->data.first, key))
+      {
+        out = map.makeIterator(t, map.oldSize + keyIndex);
+        co_return;
+      }
+    }
+    out = map.cend();
+  }
+};
+
+/*
+  Looks up count keys with up to inFlight lookups interleaved: out[i] is
+  the entry of keys[i] or end(). Works for TreeMap and HashMap; the map
+  must not change meanwhile. Returns the number of keys found.
+*/
+template <typename Map>
+std::size_t findInterleaved(const Map& map,
+                            const typename Map::key_type *keys,
+                            std::size_t count,
+                            typename Map::const_iterator *out,
+                            std::size_t inFlight = 12)
+{
+  interleaved::run(count, inFlight, [&](std::size_t i) {
+    return LookupAccess<Map>::find(map, keys[i], out[i]);
+  });
+
+  std::size_t found = 0;
+  for(std::size_t i = 0; i < count; ++i)
+    found += out[i] != map.cend();
+  return found;
+}
+
+}
+
+#endif /* AISDI_MAPS_INTERLEAVEDLOOKUP_H */
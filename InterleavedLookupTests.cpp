@@ -0,0 +1,73 @@
+#include <InterleavedLookup.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+namespace
+{
+
+using TestedMapTypes = boost::mpl::list<aisdi::TreeMap<int, std::string>,
+                                        aisdi::HashMap<int, std::string>>;
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(InterleavedLookupTests)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenLookingUpInterleaved_ThenEveryKeyGetsEnd,
+                              M,
+                              TestedMapTypes)
+{
+  const M map;
+  std::vector<int> keys = { 1, 2, 3 };
+  std::vector<typename M::const_iterator> out(keys.size());
+
+  BOOST_CHECK_EQUAL(aisdi::findInterleaved(map, keys.data(), keys.size(), out.data()), 0);
+  for (const auto& it : out)
+    BOOST_CHECK(it == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenLookingUpInterleaved_ThenResultsMatchFind,
+                              M,
+                              TestedMapTypes)
+{
+  M map;
+  for (int i = 0; i < 1000; i += 3)
+    map[i] = std::to_string(i);
+
+  std::vector<int> keys;
+  for (int i = 0; i < 500; ++i)
+    keys.push_back(i * 37 % 1200);
+
+  for (std::size_t inFlight : { 1, 5, 16, 100 })
+  {
+    std::vector<typename M::const_iterator> out(keys.size());
+    std::size_t expected = 0;
+    for (int key : keys)
+      expected += map.contains(key);
+
+    BOOST_CHECK_EQUAL(aisdi::findInterleaved(map, keys.data(), keys.size(), out.data(), inFlight),
+                      expected);
+    for (std::size_t i = 0; i < keys.size(); ++i)
+      BOOST_CHECK(out[i] == map.find(keys[i]));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenHashMapDuringRehash_WhenLookingUpInterleaved_ThenBothTablesAreSearched)
+{
+  aisdi::HashMap<int, std::string> map(8);
+  for (int i = 0; i < 9; ++i)
+    map[i] = std::to_string(i);
+
+  std::vector<int> keys = { 0, 4, 8, 9, 7 };
+  std::vector<aisdi::HashMap<int, std::string>::const_iterator> out(keys.size());
+
+  BOOST_CHECK_EQUAL(aisdi::findInterleaved(map, keys.data(), keys.size(), out.data()), 4);
+  for (std::size_t i = 0; i < keys.size(); ++i)
+    BOOST_CHECK(out[i] == map.find(keys[i]));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,290 @@
+#ifndef AISDI_MAPS_LOCKFREEHASHMAP_H
+#define AISDI_MAPS_LOCKFREEHASHMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <stdexcept>
+#include <utility>
+#include <functional>
+#include <optional>
+
+#include "EpochReclamation.h"
+
+namespace aisdi
+{
+
+/*
+  Concurrent separate-chaining map for read-mostly workloads. Bucket heads
+  and next links are atomics; lookups take no lock and never retry, they
+  walk one chain once. Writers are lock-free: insert pushes a node to the
+  chain head with a CAS, remove first marks the node's next link (the
+  node is then logically gone) and then unlinks it with a CAS on its
+  predecessor. Whoever unlinks a node hands it to EpochDomain, which frees
+  it once no reader can still be walking over it.
+
+  Entries are immutable once inserted, so readers never see a value half
+  written. The bucket count is fixed at construction (no rehash) and
+  nodes come from the heap: NodePool is not thread-safe.
+*/
+template <typename KeyType,
+          typename ValueType,
+          typename Hasher = std::hash<KeyType>,
+          typename KeyEqual = std::equal_to<KeyType>>
+class LockFreeHashMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+
+private:
+  /* low bit of a link set - the node owning the link is removed */
+  using Link = std::atomic<std::uintptr_t>;
+
+  struct Node
+  {
+    value_type data;
+    size_type code;
+    Link next;
+
+    template <typename... Args>
+    Node(size_type code_, Args&&... args)
+      :data(std::forward<Args>(args)...), code(code_), next(0) {}
+  };
+
+  Link *head;
+  size_type Size;
+  std::atomic<size_type> nrElem;
+  Hasher hasher;
+  KeyEqual equal;
+  static const size_type defaultSize = 10000;
+
+  static Node *pointer(std::uintptr_t link)
+  {
+    return reinterpret_cast<Node*>(link & ~std::uintptr_t(1));
+  }
+
+  static bool isMarked(std::uintptr_t link)
+  {
+    return link & 1;
+  }
+
+  static void deleteNode(void *n)
+  {
+    delete static_cast<Node*>(n);
+  }
+
+  Link& bucketFor(size_type code) const
+  {
+    return head[code & (Size - 1)];
+  }
+
+  /* wait-free: one pass over the chain, removed nodes are skipped */
+  template <typename K>
+  const Node *findNode(const K& key) const
+  {
+    size_type code = hasher(key);
+    std::uintptr_t link = bucketFor(code).load(std::memory_order_acquire);
+    while(link != 0)
+    {
+      const Node *n = pointer(link);
+      link = n->next.load(std::memory_order_acquire);
+      if(!isMarked(link) && n->code == code && equal(n->data.first, key))
+        return n;
+      link &= ~std::uintptr_t(1);
+    }
+    return nullptr;
+  }
+
+  /*
+    Writer lookup: finds key in its chain and unlinks the removed nodes it
+    passes. On return *prev is the link that pointed to the result (or
+    the chain end) and first is the chain head the pass started from.
+  */
+  Node *search(const key_type& key, size_type code, Link *&prev, std::uintptr_t &first)
+  {
+  retry:
+    prev = &bucketFor(code);
+    first = prev->load(std::memory_order_acquire);
+    std::uintptr_t link = first;
+    while(link != 0)
+    {
+      Node *n = pointer(link);
+      std::uintptr_t next = n->next.load(std::memory_order_acquire);
+      if(isMarked(next))
+      {
+        std::uintptr_t expected = link;
+        if(!prev->compare_exchange_strong(expected, next & ~std::uintptr_t(1),
+                                          std::memory_order_acq_rel))
+          goto retry;
+        EpochDomain::instance().retire(n, &deleteNode);
+        link = next & ~std::uintptr_t(1);
+        continue;
+      }
+      if(n->code == code && equal(n->data.first, key))
+        return n;
+      prev = &n->next;
+      link = next;
+    }
+    return nullptr;
+  }
+
+  void freeChains()
+  {
+    for(size_type i = 0; i < Size; ++i)
+    {
+      std::uintptr_t link = head[i].load(std::memory_order_relaxed);
+      while(link != 0)
+      {
+        Node *n = pointer(link);
+        link = n->next.load(std::memory_order_relaxed);
+        delete n;
+      }
+      head[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+public:
+  LockFreeHashMap()
+    :LockFreeHashMap(defaultSize)
+  {}
+
+  /* hashSize is rounded up to a power of two and never changes */
+  explicit LockFreeHashMap(size_type hashSize,
+                           const Hasher& hash = Hasher(),
+                           const KeyEqual& keyEqual = KeyEqual())
+    :nrElem(0), hasher(hash), equal(keyEqual)
+  {
+    Size = 1;
+    while(Size < hashSize)
+      Size <<= 1;
+    head = new Link[Size];
+    for(size_type i = 0; i < Size; ++i)
+      head[i].store(0, std::memory_order_relaxed);
+  }
+
+  /* no other thread may use the map any more; nodes already retired are freed by EpochDomain */
+  ~LockFreeHashMap()
+  {
+    freeChains();
+    delete[] head;
+  }
+
+  LockFreeHashMap(const LockFreeHashMap&) = delete;
+  LockFreeHashMap& operator=(const LockFreeHashMap&) = delete;
+
+  size_type bucket_count() const
+  {
+    return Size;
+  }
+
+  /* copy of the value, empty if the key is absent */
+  std::optional<mapped_type> find(const key_type& key) const
+  {
+    EpochGuard guard;
+    const Node *n = findNode(key);
+    if(n == nullptr)
+      return std::nullopt;
+    return n->data.second;
+  }
+
+  bool contains(const key_type& key) const
+  {
+    EpochGuard guard;
+    return findNode(key) != nullptr;
+  }
+
+  /* calls fn(const mapped_type&) without copying the value; false if key is absent */
+  template <typename Function>
+  bool visit(const key_type& key, Function&& fn) const
+  {
+    EpochGuard guard;
+    const Node *n = findNode(key);
+    if(n == nullptr)
+      return false;
+    fn(n->data.second);
+    return true;
+  }
+
+  /* false and no change if the key is already present */
+  bool insert(const key_type& key, const mapped_type& value)
+  {
+    EpochGuard guard;
+    size_type code = hasher(key);
+    Node *n = nullptr;
+    Link *prev;
+    std::uintptr_t first;
+
+    for(;;)
+    {
+      if(search(key, code, prev, first) != nullptr)
+      {
+        delete n;
+        return false;
+      }
+      if(n == nullptr)
+        n = new Node(code, key, value);
+      n->next.store(first, std::memory_order_relaxed);
+
+      /* any insert since the search moved the head, so the key cannot have appeared meanwhile */
+      if(bucketFor(code).compare_exchange_strong(first, reinterpret_cast<std::uintptr_t>(n),
+                                                 std::memory_order_acq_rel))
+        break;
+    }
+    nrElem.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  bool insert(const value_type& item)
+  {
+    return insert(item.first, item.second);
+  }
+
+  /* false if there was no such key */
+  bool remove(const key_type& key)
+  {
+    EpochGuard guard;
+    size_type code = hasher(key);
+    Link *prev;
+    std::uintptr_t first;
+    Node *n;
+    std::uintptr_t next;
+
+    for(;;)
+    {
+      n = search(key, code, prev, first);
+      if(n == nullptr)
+        return false;
+      next = n->next.load(std::memory_order_acquire);
+      if(isMarked(next))
+        continue;
+      if(n->next.compare_exchange_strong(next, next | 1, std::memory_order_acq_rel))
+        break;
+    }
+    nrElem.fetch_sub(1, std::memory_order_relaxed);
+
+    std::uintptr_t expected = reinterpret_cast<std::uintptr_t>(n);
+    if(prev->compare_exchange_strong(expected, next, std::memory_order_acq_rel))
+      EpochDomain::instance().retire(n, &deleteNode);
+    else
+      search(key, code, prev, first);
+    return true;
+  }
+
+  /* exact only while no writer runs */
+  size_type getSize() const
+  {
+    return nrElem.load(std::memory_order_relaxed);
+  }
+
+  bool isEmpty() const
+  {
+    return getSize() == 0;
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_LOCKFREEHASHMAP_H */
@@ -0,0 +1,189 @@
+#include <LockFreeHashMap.h>
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+
+using Map = aisdi::LockFreeHashMap<int, std::string>;
+
+/* counts live instances, so the test can tell when retired nodes are freed */
+class CountedValue
+{
+public:
+  CountedValue(int value_ = 0)
+    : value(value_)
+  {
+    ++alive;
+  }
+
+  CountedValue(const CountedValue& other)
+    : value(other.value)
+  {
+    ++alive;
+  }
+
+  ~CountedValue()
+  {
+    --alive;
+  }
+
+  int value;
+  static std::atomic<int> alive;
+};
+
+std::atomic<int> CountedValue::alive(0);
+
+template <typename Function>
+void runThreads(int count, Function fn)
+{
+  std::vector<std::thread> threads;
+  for (int t = 0; t < count; ++t)
+    threads.emplace_back(fn, t);
+  for (auto& thread : threads)
+    thread.join();
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(LockFreeHashMapTests)
+
+BOOST_AUTO_TEST_CASE(GivenEmptyMap_WhenSearchingForKey_ThenNothingIsFound)
+{
+  const Map map;
+
+  BOOST_CHECK(!map.find(42));
+  BOOST_CHECK(!map.contains(42));
+  BOOST_CHECK(map.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(GivenBucketCount_WhenConstructing_ThenItIsRoundedUpToPowerOfTwo)
+{
+  BOOST_CHECK_EQUAL(Map(1000).bucket_count(), 1024);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenInsertingAndRemoving_ThenOnlyLiveItemsAreFound)
+{
+  Map map(4);
+
+  BOOST_CHECK(map.insert(1, "Alice"));
+  BOOST_CHECK(map.insert({ 5, "Bob" }));
+  BOOST_CHECK(map.insert(9, "Chuck"));
+  BOOST_CHECK(!map.insert(5, "Dave"));
+  BOOST_CHECK_EQUAL(map.getSize(), 3);
+
+  BOOST_CHECK(map.remove(5));
+  BOOST_CHECK(!map.remove(5));
+  BOOST_CHECK(!map.contains(5));
+  BOOST_CHECK_EQUAL(*map.find(1), "Alice");
+  BOOST_CHECK_EQUAL(*map.find(9), "Chuck");
+
+  BOOST_CHECK(map.insert(5, "Dave"));
+  std::string seen;
+  BOOST_CHECK(map.visit(5, [&](const std::string& value) { seen = value; }));
+  BOOST_CHECK_EQUAL(seen, "Dave");
+  BOOST_CHECK_EQUAL(map.getSize(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(GivenRemovedItems_WhenEpochAdvances_ThenTheirNodesAreFreed)
+{
+  const int before = CountedValue::alive;
+  {
+    aisdi::LockFreeHashMap<int, CountedValue> map(16);
+    for (int i = 0; i < 1000; ++i)
+      map.insert(i, CountedValue(i));
+    for (int i = 0; i < 1000; i += 2)
+      map.remove(i);
+
+    aisdi::EpochDomain::instance().flush();
+    BOOST_CHECK_EQUAL(CountedValue::alive - before, 500);
+  }
+  BOOST_CHECK_EQUAL(CountedValue::alive - before, 0);
+}
+
+BOOST_AUTO_TEST_CASE(GivenManyThreads_WhenInsertingSameKeys_ThenEachKeyIsInsertedOnce)
+{
+  const int keys = 2000;
+  Map map(64);
+  std::atomic<int> inserted(0);
+
+  runThreads(8, [&](int t) {
+    for (int k = 0; k < keys; ++k)
+    {
+      if (map.insert(k, std::to_string(t)))
+        ++inserted;
+    }
+  });
+
+  BOOST_CHECK_EQUAL(inserted.load(), keys);
+  BOOST_CHECK_EQUAL(map.getSize(), keys);
+}
+
+BOOST_AUTO_TEST_CASE(GivenReadersAndWriters_WhenChurningKeys_ThenStableKeysAreAlwaysFound)
+{
+  const int stable = 256;
+  const int rounds = 20000;
+  Map map(32);
+  for (int k = 0; k < stable; ++k)
+    map.insert(k, "stable");
+
+  std::atomic<int> missing(0);
+  std::atomic<int> wrong(0);
+
+  runThreads(8, [&](int t) {
+    for (int i = 0; i < rounds; ++i)
+    {
+      if (t < 3)
+      {
+        /* writers churn keys above the stable range through the same chains */
+        int key = stable + (i * 13 + t) % 512;
+        if (!map.insert(key, "churn"))
+          map.remove(key);
+      }
+      else
+      {
+        int key = (i * 7 + t) % stable;
+        auto value = map.find(key);
+        if (!value)
+          ++missing;
+        else if (*value != "stable")
+          ++wrong;
+        /* misses walk whole chains, over nodes being removed at the tail too */
+        map.contains(stable + 512 + i % 64);
+      }
+    }
+  });
+
+  BOOST_CHECK_EQUAL(missing.load(), 0);
+  BOOST_CHECK_EQUAL(wrong.load(), 0);
+  for (int k = 0; k < stable; ++k)
+    BOOST_REQUIRE(map.contains(k));
+}
+
+BOOST_AUTO_TEST_CASE(GivenManyThreads_WhenRemovingSameKeys_ThenEachKeyIsRemovedOnce)
+{
+  const int keys = 5000;
+  Map map(128);
+  for (int k = 0; k < keys; ++k)
+    map.insert(k, "x");
+  std::atomic<int> removed(0);
+
+  runThreads(8, [&](int) {
+    for (int k = 0; k < keys; ++k)
+    {
+      if (map.remove(k))
+        ++removed;
+    }
+  });
+
+  BOOST_CHECK_EQUAL(removed.load(), keys);
+  BOOST_CHECK(map.isEmpty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
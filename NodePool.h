@@ -0,0 +1,235 @@
+#ifndef AISDI_MAPS_NODEPOOL_H
+#define AISDI_MAPS_NODEPOOL_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace aisdi
+{
+
+/*
+  Node allocation policies for HashMap and TreeMap. A policy provides
+  Pool<Node> with allocate()/deallocate() for single nodes, reserve(count)
+  as a hint that count nodes are about to be allocated, and release(),
+  which gives back every node at once. Maps only rely on release() when
+  bulkRelease is true; destructors of the nodes are the map's business.
+*/
+
+/*
+  Memory held by a map, see memory_usage() of HashMap and TreeMap.
+  - objectBytes: the map object itself,
+  - bucketBytes: bucket arrays, chain counters and occupancy bitmaps,
+  - nodeBytes: sizeof(Node) for every entry and the end() sentinel, or
+    the whole nodes of a BTreeMap, free slots included,
+  - overheadBytes: estimated allocator headers and rounding, plus pool
+    memory that holds no entry,
+  - payloadBytes: sizeof(value_type) of the entries, a part of nodeBytes.
+  Heap memory owned by the keys and values themselves is not counted.
+*/
+struct MemoryUsage
+{
+  std::size_t objectBytes;
+  std::size_t bucketBytes;
+  std::size_t nodeBytes;
+  std::size_t overheadBytes;
+  std::size_t payloadBytes;
+
+  std::size_t total() const
+  {
+    return objectBytes + bucketBytes + nodeBytes + overheadBytes;
+  }
+};
+
+/*
+  Estimated bookkeeping of a general-purpose malloc for one block: an
+  8-byte size header, rounding up to 16 bytes and a 32-byte minimum (the
+  glibc layout; other allocators are in the same range).
+*/
+inline std::size_t allocationOverhead(std::size_t bytes)
+{
+  std::size_t chunk = (bytes + sizeof(std::size_t) + 15) & ~std::size_t(15);
+  if(chunk < 32)
+    chunk = 32;
+  return chunk - bytes;
+}
+
+/* default: every node is a separate operator new / delete */
+struct HeapNodes
+{
+  template <typename Node>
+  class Pool
+  {
+  public:
+    static const bool bulkRelease = false;
+
+    Pool() {}
+    Pool(Pool&&) {}
+    Pool& operator=(Pool&&) { return *this; }
+
+    void *allocate()
+    {
+      return ::operator new(sizeof(Node));
+    }
+
+    void deallocate(Node *n)
+    {
+      ::operator delete(n);
+    }
+
+    /* every node is freed on its own, so there is nothing to allocate ahead */
+    void reserve(std::size_t) {}
+
+    void release() {}
+
+    /* memory beyond liveNodes * sizeof(Node) */
+    std::size_t overheadBytes(std::size_t liveNodes) const
+    {
+      return liveNodes * allocationOverhead(sizeof(Node));
+    }
+  };
+};
+
+/*
+  Opt-in slab pool: nodes are carved out of slabs of up to MaxSlabNodes
+  nodes (sizes double from 8, so tiny maps stay tiny), removed nodes go to
+  an intrusive free list and release() frees whole slabs in O(slabs).
+*/
+template <std::size_t MaxSlabNodes = 256>
+struct PooledNodes
+{
+  template <typename Node>
+  class Pool
+  {
+    union Cell
+    {
+      Cell *next;
+      alignas(Node) unsigned char storage[sizeof(Node)];
+    };
+
+    /* cell 0 of every slab links the slabs together, the rest hold nodes */
+    Cell *slabs;
+    Cell *freeList;
+    Cell *bump;
+    Cell *bumpEnd;
+    std::size_t nextSlabNodes;
+    std::size_t reservedBytes;
+
+    void addSlab(std::size_t nodes)
+    {
+      std::size_t bytes = sizeof(Cell) * (nodes + 1);
+      Cell *slab = static_cast<Cell*>(::operator new(bytes));
+      reservedBytes += bytes + allocationOverhead(bytes);
+      slab->next = slabs;
+      slabs = slab;
+      bump = slab + 1;
+      bumpEnd = bump + nodes;
+    }
+
+    void reset()
+    {
+      slabs = freeList = bump = bumpEnd = nullptr;
+      nextSlabNodes = MaxSlabNodes < 8 ? MaxSlabNodes : 8;
+      reservedBytes = 0;
+    }
+
+  public:
+    static const bool bulkRelease = true;
+
+    Pool()
+    {
+      reset();
+    }
+
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    Pool(Pool&& other)
+    {
+      slabs = other.slabs;
+      freeList = other.freeList;
+      bump = other.bump;
+      bumpEnd = other.bumpEnd;
+      nextSlabNodes = other.nextSlabNodes;
+      reservedBytes = other.reservedBytes;
+      other.reset();
+    }
+
+    Pool& operator=(Pool&& other)
+    {
+      if(this != &other)
+      {
+        release();
+        slabs = other.slabs;
+        freeList = other.freeList;
+        bump = other.bump;
+        bumpEnd = other.bumpEnd;
+        nextSlabNodes = other.nextSlabNodes;
+        reservedBytes = other.reservedBytes;
+        other.reset();
+      }
+      return *this;
+    }
+
+    ~Pool()
+    {
+      release();
+    }
+
+    void *allocate()
+    {
+      if(freeList != nullptr)
+      {
+        Cell *c = freeList;
+        freeList = c->next;
+        return c->storage;
+      }
+      if(bump == bumpEnd)
+      {
+        addSlab(nextSlabNodes);
+        if(nextSlabNodes < MaxSlabNodes)
+          nextSlabNodes *= 2;
+      }
+      return (bump++)->storage;
+    }
+
+    void deallocate(Node *n)
+    {
+      Cell *c = reinterpret_cast<Cell*>(n);
+      c->next = freeList;
+      freeList = c;
+    }
+
+    /*
+      One slab for count more nodes, past MaxSlabNodes if need be, so a map
+      copy gets its nodes in a single allocation, laid out in the order it
+      builds them. Free cells are not counted: it is meant for a fresh pool.
+    */
+    void reserve(std::size_t count)
+    {
+      if(count > static_cast<std::size_t>(bumpEnd - bump))
+        addSlab(count);
+    }
+
+    void release()
+    {
+      while(slabs != nullptr)
+      {
+        Cell *next = slabs->next;
+        ::operator delete(slabs);
+        slabs = next;
+      }
+      reset();
+    }
+
+    /* slab links, free and never used cells and the allocator overhead of every slab */
+    std::size_t overheadBytes(std::size_t liveNodes) const
+    {
+      return reservedBytes - liveNodes * sizeof(Node);
+    }
+  };
+};
+
+}
+
+#endif /* AISDI_MAPS_NODEPOOL_H */
@@ -0,0 +1,259 @@
+#include <RobinHoodHashMap.h>
+#include <SwissHashMap.h>
+
+#include <cstdint>
+#include <string>
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+namespace
+{
+
+using TestedMapTypes = boost::mpl::list<aisdi::RobinHoodHashMap<int, std::string>,
+                                        aisdi::SwissHashMap<int, std::string>>;
+
+template <typename M>
+void thenMapContainsItems(const M& map,
+                          const std::map<int, std::string>& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  for (const auto& item : expected)
+  {
+    const auto it = map.find(item.first);
+    BOOST_REQUIRE_MESSAGE(it != map.end(), "Missing required item with key: " << item.first);
+    BOOST_CHECK_EQUAL(it->second, item.second);
+  }
+}
+
+/* counts how a mapped value gets made, to catch needless temporaries and copies */
+struct CountingValue
+{
+  CountingValue()
+  {
+    ++constructed;
+  }
+
+  CountingValue(const CountingValue&)
+  {
+    ++constructed;
+    ++copied;
+  }
+
+  CountingValue(CountingValue&&)
+  {
+    ++constructed;
+    ++moved;
+  }
+
+  CountingValue& operator=(const CountingValue&) = default;
+  CountingValue& operator=(CountingValue&&) = default;
+
+  static void resetCounters()
+  {
+    constructed = copied = moved = 0;
+  }
+
+  static std::size_t constructed;
+  static std::size_t copied;
+  static std::size_t moved;
+};
+
+std::size_t CountingValue::constructed = 0;
+std::size_t CountingValue::copied = 0;
+std::size_t CountingValue::moved = 0;
+
+using CountingMapTypes = boost::mpl::list<aisdi::RobinHoodHashMap<int, CountingValue>,
+                                          aisdi::SwissHashMap<int, CountingValue>>;
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(OpenAddressingHashMapTests)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenSearchingForKey_ThenEndIsReturned,
+                              M,
+                              TestedMapTypes)
+{
+  const M map;
+
+  BOOST_CHECK(map.find(123) == map.end());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK_THROW(map.valueOf(123), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenAddingItems_ThenAllItemsAreInMap,
+                              M,
+                              TestedMapTypes)
+{
+  M map = { { 42, "Alice" }, { 27, "Bob" } };
+
+  map[13] = "Chuck";
+  map[42] = "Dave";
+
+  thenMapContainsItems(map, { { 42, "Dave" }, { 27, "Bob" }, { 13, "Chuck" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyItems_WhenTableGrows_ThenAllItemsAreFound,
+                              M,
+                              TestedMapTypes)
+{
+  M map;
+  std::map<int, std::string> expected;
+
+  for(int i = 0; i < 5000; ++i)
+  {
+    map[i * 1024] = std::to_string(i);
+    expected[i * 1024] = std::to_string(i);
+  }
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyItems_WhenRemovingEveryOther_ThenRemainingItemsAreFound,
+                              M,
+                              TestedMapTypes)
+{
+  M map;
+  std::map<int, std::string> expected;
+
+  for(int i = 0; i < 3000; ++i)
+    map[i] = std::to_string(i);
+
+  for(int i = 0; i < 3000; ++i)
+  {
+    if(i % 2 == 0)
+      map.remove(i);
+    else
+      expected[i] = std::to_string(i);
+  }
+
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_THROW(map.remove(0), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenIterating_ThenEveryItemIsVisitedOnce,
+                              M,
+                              TestedMapTypes)
+{
+  M map;
+  for(int i = 0; i < 100; ++i)
+    map[i] = "x";
+
+  std::map<int, int> seen;
+  for(auto it = map.begin(); it != map.end(); ++it)
+    ++seen[it->first];
+
+  BOOST_CHECK_EQUAL(seen.size(), 100);
+  for(const auto& s : seen)
+    BOOST_CHECK_EQUAL(s.second, 1);
+
+  auto last = map.end();
+  --last;
+  BOOST_CHECK(++last == map.end());
+  BOOST_CHECK_THROW(++map.end(), std::out_of_range);
+  BOOST_CHECK_THROW(*map.end(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenRemovingItemByIterator_ThenItemIsRemoved,
+                              M,
+                              TestedMapTypes)
+{
+  M map = { { 42, "Alice" }, { 27, "Bob" } };
+
+  map.remove(map.find(42));
+
+  thenMapContainsItems(map, { { 27, "Bob" } });
+  BOOST_CHECK_THROW(map.remove(map.end()), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenCopyingAndMoving_ThenMapsAreEqual,
+                              M,
+                              TestedMapTypes)
+{
+  M map = { { 753, "Rome" }, { 1789, "Paris" } };
+  M copy(map);
+
+  BOOST_CHECK(copy == map);
+
+  M moved(std::move(copy));
+  BOOST_CHECK(moved == map);
+  BOOST_CHECK(copy.isEmpty());
+
+  copy = moved;
+  copy[1410] = "Grunwald";
+  BOOST_CHECK(copy != map);
+  thenMapContainsItems(copy, { { 753, "Rome" }, { 1789, "Paris" }, { 1410, "Grunwald" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenIndexingMissingKeys_ThenEachValueIsBuiltOnceInItsSlot,
+                              M,
+                              CountingMapTypes)
+{
+  M map;
+  CountingValue::resetCounters();
+
+  /* 10 entries stay below the first grow, so no slot is moved */
+  for(int i = 0; i < 10; ++i)
+    map[i * 16];
+
+  BOOST_CHECK_EQUAL(map.getSize(), 10);
+  BOOST_CHECK_EQUAL(CountingValue::constructed, 10);
+  BOOST_CHECK_EQUAL(CountingValue::copied, 0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenIndexingExistingKey_ThenNothingIsBuilt,
+                              M,
+                              CountingMapTypes)
+{
+  M map;
+  map[7];
+  CountingValue::resetCounters();
+
+  map[7];
+  map[7];
+
+  BOOST_CHECK_EQUAL(map.getSize(), 1);
+  BOOST_CHECK_EQUAL(CountingValue::constructed, 0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMovedFromMap_WhenIndexingKey_ThenItemIsAdded,
+                              M,
+                              TestedMapTypes)
+{
+  M map = { { 753, "Rome" } };
+  M other(std::move(map));
+
+  map[1410] = "Grunwald";
+
+  thenMapContainsItems(map, { { 1410, "Grunwald" } });
+  thenMapContainsItems(other, { { 753, "Rome" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyItems_WhenIndexingAfterRemovals_ThenEachKeyIsStoredOnce,
+                              M,
+                              TestedMapTypes)
+{
+  M map;
+  std::map<int, std::string> expected;
+
+  for(int round = 0; round < 4; ++round)
+  {
+    for(int i = 0; i < 3000; ++i)
+    {
+      map[i * 7] = std::to_string(round);
+      expected[i * 7] = std::to_string(round);
+    }
+    for(int i = round; i < 3000; i += 3)
+    {
+      map.remove(i * 7);
+      expected.erase(i * 7);
+    }
+  }
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
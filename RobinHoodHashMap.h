@@ -0,0 +1,656 @@
+#ifndef AISDI_MAPS_ROBINHOODHASHMAP_H
+#define AISDI_MAPS_ROBINHOODHASHMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+#include <functional>
+#include <new>
+#include <tuple>
+
+namespace aisdi
+{
+
+/*
+  Open addressing variant of HashMap. Entries live inline in one contiguous
+  slot array, collisions are resolved with Robin Hood linear probing and
+  removal uses backward shift, so there are no tombstones.
+*/
+template <typename KeyType, typename ValueType>
+class RobinHoodHashMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  struct Slot
+  {
+    /* 0 - empty slot, otherwise distance from home slot + 1 */
+    std::uint32_t dist;
+    alignas(value_type) unsigned char storage[sizeof(value_type)];
+
+    value_type& data()
+    {
+      return *reinterpret_cast<value_type*>(storage);
+    }
+
+    const value_type& data() const
+    {
+      return *reinterpret_cast<const value_type*>(storage);
+    }
+  };
+
+  Slot *slots;
+  size_type capacity, nrElem, shift;
+  const size_type minCapacity = 16;
+
+  /* max load factor 7/8 */
+  size_type maxElements() const
+  {
+    return capacity - capacity / 8;
+  }
+
+  static size_type roundUp(size_type n)
+  {
+    size_type x = 1;
+    while(x < n)
+      x <<= 1;
+    return x;
+  }
+
+  void allocate(size_type cap)
+  {
+    capacity = cap;
+    shift = 64;
+    for(size_type c = cap; c > 1; c >>= 1)
+      --shift;
+    slots = static_cast<Slot*>(::operator new(sizeof(Slot) * capacity));
+    for(size_type i = 0; i < capacity; ++i)
+      slots[i].dist = 0;
+    nrElem = 0;
+  }
+
+  void destroyAll()
+  {
+    if(slots == nullptr)
+      return;
+    for(size_type i = 0; i < capacity; ++i)
+    {
+      if(slots[i].dist != 0)
+        slots[i].data().~value_type();
+    }
+    ::operator delete(slots);
+    slots = nullptr;
+  }
+
+  void moveSlot(Slot &to, Slot &from, std::uint32_t dist)
+  {
+    new (to.storage) value_type(std::move(from.data()));
+    from.data().~value_type();
+    to.dist = dist;
+  }
+
+  void grow()
+  {
+    Slot *oldSlots = slots;
+    size_type oldCapacity = capacity;
+    allocate(capacity == 0 ? minCapacity : capacity * 2);
+
+    for(size_type i = 0; i < oldCapacity; ++i)
+    {
+      if(oldSlots[i].dist != 0)
+      {
+        Slot *s = place(oldSlots[i].data().first);
+        new (s->storage) value_type(std::move(oldSlots[i].data()));
+        oldSlots[i].data().~value_type();
+      }
+    }
+    ::operator delete(oldSlots);
+  }
+
+  /*
+    Finds the slot a new key belongs to, shifts the rest of its cluster one
+    slot forward and returns the (now free) slot with dist already set.
+  */
+  Slot *place(const key_type& key)
+  {
+    size_type i = Hash(key);
+    std::uint32_t dist = 1;
+
+    while(slots[i].dist >= dist)
+    {
+      ++dist;
+      i = (i + 1) & (capacity - 1);
+    }
+    return placeAt(i, dist);
+  }
+
+  /* frees slot i, where the probe for a new key stopped at distance dist */
+  Slot *placeAt(size_type i, std::uint32_t dist)
+  {
+    if(slots[i].dist != 0)
+    {
+      size_type j = i;
+      while(slots[j].dist != 0)
+        j = (j + 1) & (capacity - 1);
+
+      while(j != i)
+      {
+        size_type prev = (j - 1) & (capacity - 1);
+        moveSlot(slots[j], slots[prev], slots[prev].dist + 1);
+        j = prev;
+      }
+    }
+    slots[i].dist = dist;
+    ++nrElem;
+    return &slots[i];
+  }
+
+  /*
+    One probe serves both the lookup and the insertion: the key is either
+    found on the way or the probe stops where it belongs. Only a table that
+    has to grow first is probed again. A new entry is built in its slot
+    from key and args.
+  */
+  template <typename K, typename... Args>
+  std::pair<Slot*, bool> tryEmplaceB(K&& key, Args&&... args)
+  {
+    size_type i = 0;
+    std::uint32_t dist = 1;
+    if(capacity != 0)
+    {
+      i = Hash(key);
+      while(slots[i].dist >= dist)
+      {
+        if(slots[i].dist == dist && slots[i].data().first == key)
+          return std::pair<Slot*, bool>(&slots[i], false);
+        ++dist;
+        i = (i + 1) & (capacity - 1);
+      }
+    }
+
+    Slot *s;
+    if(nrElem + 1 > maxElements())
+    {
+      grow();
+      s = place(key);
+    }
+    else
+      s = placeAt(i, dist);
+
+    try
+    {
+      new (s->storage) value_type(std::piecewise_construct,
+                                  std::forward_as_tuple(std::forward<K>(key)),
+                                  std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+    catch(...)
+    {
+      removeSlot(s, false);
+      throw;
+    }
+    return std::pair<Slot*, bool>(s, true);
+  }
+
+  /* insertB without a lookup */
+  template <typename V>
+  void insertValue(V&& _data)
+  {
+    if(nrElem + 1 > maxElements())
+      grow();
+
+    Slot *s = place(_data.first);
+    try
+    {
+      new (s->storage) value_type(std::forward<V>(_data));
+    }
+    catch(...)
+    {
+      removeSlot(s, false);
+      throw;
+    }
+  }
+
+  size_type firstFrom(size_type i) const
+  {
+    while(i < capacity && slots[i].dist == 0)
+      ++i;
+    return i;
+  }
+
+  const_iterator makeIterator(size_type index) const
+  {
+    ConstIterator it;
+    it.index = index;
+    it.ptrMap = this;
+    return it;
+  }
+
+public:
+
+  /* Fibonacci hashing: keeps the high bits of the product, so even an identity std::hash spreads well */
+  size_type Hash(const key_type& key) const
+  {
+    std::uint64_t x = std::hash<key_type>{}(key);
+    return static_cast<size_type>((x * 0x9E3779B97F4A7C15ull) >> shift);
+  }
+
+  void makeEmpty()
+  {
+    for(size_type i = 0; i < capacity; ++i)
+    {
+      if(slots[i].dist != 0)
+      {
+        slots[i].data().~value_type();
+        slots[i].dist = 0;
+      }
+    }
+    nrElem = 0;
+  }
+
+  Slot *findB(const key_type& key) const
+  {
+    if(nrElem == 0)
+      return nullptr;
+
+    size_type i = Hash(key);
+    std::uint32_t dist = 1;
+
+    /* Robin Hood invariant: the key cannot be further than a richer slot */
+    while(slots[i].dist >= dist)
+    {
+      if(slots[i].dist == dist && slots[i].data().first == key)
+        return &slots[i];
+      ++dist;
+      i = (i + 1) & (capacity - 1);
+    }
+    return nullptr;
+  }
+
+  void insertB(const value_type& _data)
+  {
+    insertValue(_data);
+  }
+
+  /* the key of a value_type is const and still gets copied, the value is moved */
+  void insertB(value_type&& _data)
+  {
+    insertValue(std::move(_data));
+  }
+
+  void removeB(const key_type& key)
+  {
+    Slot *s = findB(key);
+    if(s == nullptr)
+      throw std::out_of_range("out of range, no such elem to remove");
+    removeSlot(s, true);
+  }
+
+  /* backward shift deletion */
+  void removeSlot(Slot *s, bool destroy)
+  {
+    size_type i = s - slots;
+    if(destroy)
+      slots[i].data().~value_type();
+    slots[i].dist = 0;
+
+    size_type j = (i + 1) & (capacity - 1);
+    while(slots[j].dist > 1)
+    {
+      moveSlot(slots[i], slots[j], slots[j].dist - 1);
+      slots[j].dist = 0;
+      i = j;
+      j = (j + 1) & (capacity - 1);
+    }
+    --nrElem;
+  }
+
+  RobinHoodHashMap()
+  {
+    allocate(minCapacity);
+  }
+
+  RobinHoodHashMap(size_type expected)
+  {
+    size_type cap = roundUp(expected + expected / 7 + 1);
+    allocate(cap < minCapacity ? minCapacity : cap);
+  }
+
+  ~RobinHoodHashMap()
+  {
+    destroyAll();
+  }
+
+  RobinHoodHashMap(std::initializer_list<value_type> list)
+    :RobinHoodHashMap(list.size())
+  {
+    for(auto it = list.begin(); it != list.end(); ++it)
+      (*this)[it->first] = it->second;
+  }
+
+  RobinHoodHashMap(const RobinHoodHashMap& other)
+  {
+    allocate(other.capacity);
+    for(size_type i = 0; i < capacity; ++i)
+    {
+      if(other.slots[i].dist != 0)
+      {
+        new (slots[i].storage) value_type(other.slots[i].data());
+        slots[i].dist = other.slots[i].dist;
+        ++nrElem;
+      }
+    }
+  }
+
+  RobinHoodHashMap(RobinHoodHashMap&& other)
+  {
+    slots = other.slots;
+    capacity = other.capacity;
+    shift = other.shift;
+    nrElem = other.nrElem;
+    other.slots = nullptr;
+    other.capacity = 0;
+    other.nrElem = 0;
+  }
+
+  RobinHoodHashMap& operator=(const RobinHoodHashMap& other)
+  {
+    if(this == &other)
+      return *this;
+
+    RobinHoodHashMap tmp(other);
+    destroyAll();
+    slots = tmp.slots;
+    capacity = tmp.capacity;
+    shift = tmp.shift;
+    nrElem = tmp.nrElem;
+    tmp.slots = nullptr;
+    return *this;
+  }
+
+  RobinHoodHashMap& operator=(RobinHoodHashMap&& other)
+  {
+    if(this == &other)
+      return *this;
+
+    destroyAll();
+    slots = other.slots;
+    capacity = other.capacity;
+    shift = other.shift;
+    nrElem = other.nrElem;
+    other.slots = nullptr;
+    other.capacity = 0;
+    other.nrElem = 0;
+    return *this;
+  }
+
+  bool isEmpty() const
+  {
+    return nrElem == 0;
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    return tryEmplaceB(key).first->data().second;
+  }
+
+  mapped_type& operator[](key_type&& key)
+  {
+    return tryEmplaceB(std::move(key)).first->data().second;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    Slot *s = findB(key);
+    if(s == nullptr)
+      throw std::out_of_range("out of range");
+    return s->data().second;
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    Slot *s = findB(key);
+    if(s == nullptr)
+      throw std::out_of_range("out of range");
+    return s->data().second;
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    Slot *s = findB(key);
+    return makeIterator(s == nullptr ? capacity : s - slots);
+  }
+
+  iterator find(const key_type& key)
+  {
+    Slot *s = findB(key);
+    return iterator(makeIterator(s == nullptr ? capacity : s - slots));
+  }
+
+  void remove(const key_type& key)
+  {
+    removeB(key);
+  }
+
+  void remove(const const_iterator& it)
+  {
+    if(it.index >= capacity)
+      throw std::out_of_range("out of range, cannot remove end");
+    removeSlot(&slots[it.index], true);
+  }
+
+  size_type getSize() const
+  {
+    return nrElem;
+  }
+
+  bool operator==(const RobinHoodHashMap& other) const
+  {
+    if(getSize() != other.getSize())
+      return false;
+
+    for(const auto& a : other)
+    {
+      const Slot *s = findB(a.first);
+      if(s == nullptr || s->data().second != a.second)
+        return false;
+    }
+    return true;
+  }
+
+  bool operator!=(const RobinHoodHashMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  iterator begin()
+  {
+    return iterator(cbegin());
+  }
+
+  iterator end()
+  {
+    return iterator(cend());
+  }
+
+  const_iterator cbegin() const
+  {
+    return makeIterator(firstFrom(0));
+  }
+
+  const_iterator cend() const
+  {
+    return makeIterator(capacity);
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+template <typename KeyType, typename ValueType>
+class RobinHoodHashMap<KeyType, ValueType>::ConstIterator
+{
+  friend class RobinHoodHashMap;
+
+public:
+  using reference = typename RobinHoodHashMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename RobinHoodHashMap::value_type;
+  using pointer = const typename RobinHoodHashMap::value_type*;
+
+private:
+  size_type index;
+  const RobinHoodHashMap<KeyType, ValueType> *ptrMap;
+
+public:
+
+  explicit ConstIterator()
+  {
+    index = 0;
+    ptrMap = nullptr;
+  }
+
+  ConstIterator(const ConstIterator& other)
+  {
+    index = other.index;
+    ptrMap = other.ptrMap;
+  }
+
+  ConstIterator& operator=(const ConstIterator& other) = default;
+
+  ConstIterator& operator++()
+  {
+    if(index >= ptrMap->capacity)
+      throw std::out_of_range("out of range (on last)");
+
+    index = ptrMap->firstFrom(index + 1);
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    ConstIterator it = *this;
+    ++(*this);
+    return it;
+  }
+
+  ConstIterator& operator--()
+  {
+    size_type i = index;
+    while(i > 0)
+    {
+      --i;
+      if(ptrMap->slots[i].dist != 0)
+      {
+        index = i;
+        return *this;
+      }
+    }
+    throw std::out_of_range("out of range (on first)");
+  }
+
+  ConstIterator operator--(int)
+  {
+    ConstIterator it = *this;
+    --(*this);
+    return it;
+  }
+
+  reference operator*() const
+  {
+    if(ptrMap == nullptr || index >= ptrMap->capacity)
+      throw std::out_of_range("out of range operator*");
+
+    return ptrMap->slots[index].data();
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return index == other.index && ptrMap == other.ptrMap;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+template <typename KeyType, typename ValueType>
+class RobinHoodHashMap<KeyType, ValueType>::Iterator : public RobinHoodHashMap<KeyType, ValueType>::ConstIterator
+{
+public:
+  using reference = typename RobinHoodHashMap::reference;
+  using pointer = typename RobinHoodHashMap::value_type*;
+
+  explicit Iterator()
+  {}
+
+  Iterator(const ConstIterator& other)
+    : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  reference operator*() const
+  {
+    // ugly cast, yet reduces code duplication.
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_ROBINHOODHASHMAP_H */
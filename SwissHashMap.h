@@ -0,0 +1,746 @@
+#ifndef AISDI_MAPS_SWISSHASHMAP_H
+#define AISDI_MAPS_SWISSHASHMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+#include <functional>
+#include <new>
+#include <tuple>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AISDI_MAPS_SWISS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace aisdi
+{
+
+/*
+  Group probing (Swiss table) variant of HashMap. Every slot has a one byte
+  control entry: empty, deleted or the 7 low bits of the key hash. Lookups
+  compare 16 control bytes at once (SSE2, scalar fallback otherwise) and
+  only touch slots whose fingerprint matches.
+*/
+template <typename KeyType, typename ValueType>
+class SwissHashMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  static const std::int8_t kEmpty = -128;
+  static const std::int8_t kDeleted = -2;
+  static const size_type groupWidth = 16;
+
+  struct Slot
+  {
+    alignas(value_type) unsigned char storage[sizeof(value_type)];
+
+    value_type& data()
+    {
+      return *reinterpret_cast<value_type*>(storage);
+    }
+
+    const value_type& data() const
+    {
+      return *reinterpret_cast<const value_type*>(storage);
+    }
+  };
+
+  /* one group of control bytes, bit i of a mask refers to slot i of the group */
+  struct Group
+  {
+    const std::int8_t *ctrl;
+
+    std::uint32_t match(std::int8_t h2) const
+    {
+#ifdef AISDI_MAPS_SWISS_SSE2
+      __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+      return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), c)));
+#else
+      std::uint32_t mask = 0;
+      for(size_type i = 0; i < groupWidth; ++i)
+        mask |= static_cast<std::uint32_t>(ctrl[i] == h2) << i;
+      return mask;
+#endif
+    }
+
+    std::uint32_t matchEmpty() const
+    {
+      return match(kEmpty);
+    }
+
+    /* empty and deleted bytes are the only negative ones */
+    std::uint32_t matchFree() const
+    {
+#ifdef AISDI_MAPS_SWISS_SSE2
+      __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+      return static_cast<std::uint32_t>(_mm_movemask_epi8(c));
+#else
+      std::uint32_t mask = 0;
+      for(size_type i = 0; i < groupWidth; ++i)
+        mask |= static_cast<std::uint32_t>(ctrl[i] < 0) << i;
+      return mask;
+#endif
+    }
+  };
+
+  std::int8_t *ctrl;
+  Slot *slots;
+  size_type capacity, nrElem, nrDeleted;
+  const size_type minCapacity = 16;
+
+  static int lowestBit(std::uint32_t mask)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#else
+    int i = 0;
+    while(!(mask & 1u))
+    {
+      mask >>= 1;
+      ++i;
+    }
+    return i;
+#endif
+  }
+
+  static size_type roundUp(size_type n)
+  {
+    size_type x = groupWidth;
+    while(x < n)
+      x <<= 1;
+    return x;
+  }
+
+  /* max load factor 7/8, deleted slots count as used until the next rehash */
+  size_type maxElements() const
+  {
+    return capacity - capacity / 8;
+  }
+
+  size_type groupMask() const
+  {
+    return capacity / groupWidth - 1;
+  }
+
+  Group groupAt(size_type g) const
+  {
+    return Group{ctrl + g * groupWidth};
+  }
+
+  void allocate(size_type cap)
+  {
+    capacity = cap;
+    ctrl = new std::int8_t[capacity];
+    for(size_type i = 0; i < capacity; ++i)
+      ctrl[i] = kEmpty;
+    slots = static_cast<Slot*>(::operator new(sizeof(Slot) * capacity));
+    nrElem = 0;
+    nrDeleted = 0;
+  }
+
+  void destroyAll()
+  {
+    if(ctrl == nullptr)
+      return;
+    for(size_type i = 0; i < capacity; ++i)
+    {
+      if(ctrl[i] >= 0)
+        slots[i].data().~value_type();
+    }
+    delete[] ctrl;
+    ::operator delete(slots);
+    ctrl = nullptr;
+    slots = nullptr;
+  }
+
+  void rehashTo(size_type cap)
+  {
+    std::int8_t *oldCtrl = ctrl;
+    Slot *oldSlots = slots;
+    size_type oldCapacity = capacity;
+    allocate(cap);
+
+    for(size_type i = 0; i < oldCapacity; ++i)
+    {
+      if(oldCtrl[i] >= 0)
+      {
+        Slot *s = place(hashOf(oldSlots[i].data().first));
+        new (s->storage) value_type(std::move(oldSlots[i].data()));
+        oldSlots[i].data().~value_type();
+      }
+    }
+    delete[] oldCtrl;
+    ::operator delete(oldSlots);
+  }
+
+  /* claims the first free slot on the probe sequence of hash */
+  Slot *place(size_type hash)
+  {
+    size_type g = (hash >> 7) & groupMask();
+    for(size_type step = 1; ; ++step)
+    {
+      std::uint32_t mask = groupAt(g).matchFree();
+      if(mask != 0)
+      {
+        size_type i = g * groupWidth + lowestBit(mask);
+        if(ctrl[i] == kDeleted)
+          --nrDeleted;
+        ctrl[i] = static_cast<std::int8_t>(hash & 0x7F);
+        ++nrElem;
+        return &slots[i];
+      }
+      g = (g + step) & groupMask();
+    }
+  }
+
+  /* makes room for one more entry: grows, or only drops the tombstones when they are most of the load */
+  void reserveOne()
+  {
+    if(nrElem + nrDeleted + 1 > maxElements())
+    {
+      if(capacity != 0 && nrDeleted > capacity / 4)
+        rehashTo(capacity);
+      else
+        rehashTo(capacity == 0 ? minCapacity : capacity * 2);
+    }
+  }
+
+  /* an entry whose construction threw leaves a tombstone behind */
+  void abandonSlot(Slot *s)
+  {
+    ctrl[s - slots] = kDeleted;
+    ++nrDeleted;
+    --nrElem;
+  }
+
+  /*
+    One probe serves both the lookup and the insertion: it remembers the
+    first free slot on the way, which is the one place() would claim. Only
+    a table that has to grow first is probed again. A new entry is built
+    in its slot from key and args.
+  */
+  template <typename K, typename... Args>
+  std::pair<Slot*, bool> tryEmplaceB(K&& key, Args&&... args)
+  {
+    size_type hash = hashOf(key);
+    size_type freeSlot = capacity;
+    if(capacity != 0)
+    {
+      std::int8_t h2 = static_cast<std::int8_t>(hash & 0x7F);
+      size_type g = (hash >> 7) & groupMask();
+      for(size_type step = 1; step <= capacity / groupWidth; ++step)
+      {
+        Group group = groupAt(g);
+        for(std::uint32_t mask = group.match(h2); mask != 0; mask &= mask - 1)
+        {
+          size_type i = g * groupWidth + lowestBit(mask);
+          if(slots[i].data().first == key)
+            return std::pair<Slot*, bool>(&slots[i], false);
+        }
+        std::uint32_t free = group.matchFree();
+        if(freeSlot == capacity && free != 0)
+          freeSlot = g * groupWidth + lowestBit(free);
+        if(group.matchEmpty() != 0)
+          break;
+        g = (g + step) & groupMask();
+      }
+    }
+
+    Slot *s;
+    if(nrElem + nrDeleted + 1 > maxElements())
+    {
+      reserveOne();
+      s = place(hash);
+    }
+    else
+    {
+      if(ctrl[freeSlot] == kDeleted)
+        --nrDeleted;
+      ctrl[freeSlot] = static_cast<std::int8_t>(hash & 0x7F);
+      ++nrElem;
+      s = &slots[freeSlot];
+    }
+
+    try
+    {
+      new (s->storage) value_type(std::piecewise_construct,
+                                  std::forward_as_tuple(std::forward<K>(key)),
+                                  std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+    catch(...)
+    {
+      abandonSlot(s);
+      throw;
+    }
+    return std::pair<Slot*, bool>(s, true);
+  }
+
+  /* insertB without a lookup */
+  template <typename V>
+  void insertValue(V&& _data)
+  {
+    reserveOne();
+
+    Slot *s = place(hashOf(_data.first));
+    try
+    {
+      new (s->storage) value_type(std::forward<V>(_data));
+    }
+    catch(...)
+    {
+      abandonSlot(s);
+      throw;
+    }
+  }
+
+  size_type firstFrom(size_type i) const
+  {
+    while(i < capacity && ctrl[i] < 0)
+      ++i;
+    return i;
+  }
+
+  const_iterator makeIterator(size_type index) const
+  {
+    ConstIterator it;
+    it.index = index;
+    it.ptrMap = this;
+    return it;
+  }
+
+public:
+
+  /* std::hash of integers is the identity, mix it so that both H1 and H2 get entropy */
+  static size_type hashOf(const key_type& key)
+  {
+    std::uint64_t x = std::hash<key_type>{}(key);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    return static_cast<size_type>(x);
+  }
+
+  void makeEmpty()
+  {
+    for(size_type i = 0; i < capacity; ++i)
+    {
+      if(ctrl[i] >= 0)
+        slots[i].data().~value_type();
+      ctrl[i] = kEmpty;
+    }
+    nrElem = 0;
+    nrDeleted = 0;
+  }
+
+  Slot *findB(const key_type& key) const
+  {
+    if(nrElem == 0)
+      return nullptr;
+
+    size_type hash = hashOf(key);
+    std::int8_t h2 = static_cast<std::int8_t>(hash & 0x7F);
+    size_type g = (hash >> 7) & groupMask();
+
+    /* triangular probing visits every group once, as the group count is a power of two */
+    for(size_type step = 1; step <= capacity / groupWidth; ++step)
+    {
+      Group group = groupAt(g);
+      for(std::uint32_t mask = group.match(h2); mask != 0; mask &= mask - 1)
+      {
+        size_type i = g * groupWidth + lowestBit(mask);
+        if(slots[i].data().first == key)
+          return &slots[i];
+      }
+      if(group.matchEmpty() != 0)
+        return nullptr;
+      g = (g + step) & groupMask();
+    }
+    return nullptr;
+  }
+
+  void insertB(const value_type& _data)
+  {
+    insertValue(_data);
+  }
+
+  /* the key of a value_type is const and still gets copied, the value is moved */
+  void insertB(value_type&& _data)
+  {
+    insertValue(std::move(_data));
+  }
+
+  void removeB(const key_type& key)
+  {
+    Slot *s = findB(key);
+    if(s == nullptr)
+      throw std::out_of_range("out of range, no such elem to remove");
+    removeSlot(s - slots);
+  }
+
+  void removeSlot(size_type i)
+  {
+    slots[i].data().~value_type();
+    /* probing never went past a group with an empty slot, so no tombstone is needed there */
+    if(groupAt(i / groupWidth).matchEmpty() != 0)
+      ctrl[i] = kEmpty;
+    else
+    {
+      ctrl[i] = kDeleted;
+      ++nrDeleted;
+    }
+    --nrElem;
+  }
+
+  SwissHashMap()
+  {
+    allocate(minCapacity);
+  }
+
+  SwissHashMap(size_type expected)
+  {
+    allocate(roundUp(expected + expected / 7 + 1));
+  }
+
+  ~SwissHashMap()
+  {
+    destroyAll();
+  }
+
+  SwissHashMap(std::initializer_list<value_type> list)
+    :SwissHashMap(list.size())
+  {
+    for(auto it = list.begin(); it != list.end(); ++it)
+      (*this)[it->first] = it->second;
+  }
+
+  SwissHashMap(const SwissHashMap& other)
+  {
+    allocate(other.capacity);
+    for(size_type i = 0; i < capacity; ++i)
+    {
+      if(other.ctrl[i] >= 0)
+      {
+        new (slots[i].storage) value_type(other.slots[i].data());
+        ++nrElem;
+      }
+      ctrl[i] = other.ctrl[i];
+    }
+    nrDeleted = other.nrDeleted;
+  }
+
+  SwissHashMap(SwissHashMap&& other)
+  {
+    ctrl = other.ctrl;
+    slots = other.slots;
+    capacity = other.capacity;
+    nrElem = other.nrElem;
+    nrDeleted = other.nrDeleted;
+    other.ctrl = nullptr;
+    other.slots = nullptr;
+    other.capacity = 0;
+    other.nrElem = 0;
+    other.nrDeleted = 0;
+  }
+
+  SwissHashMap& operator=(const SwissHashMap& other)
+  {
+    if(this == &other)
+      return *this;
+
+    SwissHashMap tmp(other);
+    *this = std::move(tmp);
+    return *this;
+  }
+
+  SwissHashMap& operator=(SwissHashMap&& other)
+  {
+    if(this == &other)
+      return *this;
+
+    destroyAll();
+    ctrl = other.ctrl;
+    slots = other.slots;
+    capacity = other.capacity;
+    nrElem = other.nrElem;
+    nrDeleted = other.nrDeleted;
+    other.ctrl = nullptr;
+    other.slots = nullptr;
+    other.capacity = 0;
+    other.nrElem = 0;
+    other.nrDeleted = 0;
+    return *this;
+  }
+
+  bool isEmpty() const
+  {
+    return nrElem == 0;
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    return tryEmplaceB(key).first->data().second;
+  }
+
+  mapped_type& operator[](key_type&& key)
+  {
+    return tryEmplaceB(std::move(key)).first->data().second;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    Slot *s = findB(key);
+    if(s == nullptr)
+      throw std::out_of_range("out of range");
+    return s->data().second;
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    Slot *s = findB(key);
+    if(s == nullptr)
+      throw std::out_of_range("out of range");
+    return s->data().second;
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    Slot *s = findB(key);
+    return makeIterator(s == nullptr ? capacity : s - slots);
+  }
+
+  iterator find(const key_type& key)
+  {
+    Slot *s = findB(key);
+    return iterator(makeIterator(s == nullptr ? capacity : s - slots));
+  }
+
+  void remove(const key_type& key)
+  {
+    removeB(key);
+  }
+
+  void remove(const const_iterator& it)
+  {
+    if(it.index >= capacity)
+      throw std::out_of_range("out of range, cannot remove end");
+    removeSlot(it.index);
+  }
+
+  size_type getSize() const
+  {
+    return nrElem;
+  }
+
+  bool operator==(const SwissHashMap& other) const
+  {
+    if(getSize() != other.getSize())
+      return false;
+
+    for(const auto& a : other)
+    {
+      const Slot *s = findB(a.first);
+      if(s == nullptr || s->data().second != a.second)
+        return false;
+    }
+    return true;
+  }
+
+  bool operator!=(const SwissHashMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  iterator begin()
+  {
+    return iterator(cbegin());
+  }
+
+  iterator end()
+  {
+    return iterator(cend());
+  }
+
+  const_iterator cbegin() const
+  {
+    return makeIterator(firstFrom(0));
+  }
+
+  const_iterator cend() const
+  {
+    return makeIterator(capacity);
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+template <typename KeyType, typename ValueType>
+class SwissHashMap<KeyType, ValueType>::ConstIterator
+{
+  friend class SwissHashMap;
+
+public:
+  using reference = typename SwissHashMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename SwissHashMap::value_type;
+  using pointer = const typename SwissHashMap::value_type*;
+
+private:
+  size_type index;
+  const SwissHashMap<KeyType, ValueType> *ptrMap;
+
+public:
+
+  explicit ConstIterator()
+  {
+    index = 0;
+    ptrMap = nullptr;
+  }
+
+  ConstIterator(const ConstIterator& other)
+  {
+    index = other.index;
+    ptrMap = other.ptrMap;
+  }
+
+  ConstIterator& operator=(const ConstIterator& other) = default;
+
+  ConstIterator& operator++()
+  {
+    if(index >= ptrMap->capacity)
+      throw std::out_of_range("out of range (on last)");
+
+    index = ptrMap->firstFrom(index + 1);
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    ConstIterator it = *this;
+    ++(*this);
+    return it;
+  }
+
+  ConstIterator& operator--()
+  {
+    size_type i = index;
+    while(i > 0)
+    {
+      --i;
+      if(ptrMap->ctrl[i] >= 0)
+      {
+        index = i;
+        return *this;
+      }
+    }
+    throw std::out_of_range("out of range (on first)");
+  }
+
+  ConstIterator operator--(int)
+  {
+    ConstIterator it = *this;
+    --(*this);
+    return it;
+  }
+
+  reference operator*() const
+  {
+    if(ptrMap == nullptr || index >= ptrMap->capacity)
+      throw std::out_of_range("out of range operator*");
+
+    return ptrMap->slots[index].data();
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return index == other.index && ptrMap == other.ptrMap;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+template <typename KeyType, typename ValueType>
+class SwissHashMap<KeyType, ValueType>::Iterator : public SwissHashMap<KeyType, ValueType>::ConstIterator
+{
+public:
+  using reference = typename SwissHashMap::reference;
+  using pointer = typename SwissHashMap::value_type*;
+
+  explicit Iterator()
+  {}
+
+  Iterator(const ConstIterator& other)
+    : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  reference operator*() const
+  {
+    // ugly cast, yet reduces code duplication.
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_SWISSHASHMAP_H */
@@ -0,0 +1,48 @@
+#ifndef AISDI_MAPS_TRANSPARENTLOOKUP_H
+#define AISDI_MAPS_TRANSPARENTLOOKUP_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace aisdi
+{
+
+/*
+  Heterogeneous lookup support. When the hasher and key equality (HashMap)
+  or the comparator (TreeMap) declare is_transparent, find, contains,
+  valueOf and remove accept any key type they can handle, so e.g. a
+  std::string_view can be looked up without building a std::string.
+*/
+template <typename T, typename = void>
+struct IsTransparent : std::false_type {};
+
+template <typename T>
+struct IsTransparent<T, std::void_t<typename T::is_transparent>> : std::true_type {};
+
+/* std::hash of std::string and std::string_view agree, so either can be used to probe */
+struct StringHash
+{
+  using is_transparent = void;
+
+  std::size_t operator()(std::string_view s) const
+  {
+    return std::hash<std::string_view>{}(s);
+  }
+
+  std::size_t operator()(const std::string& s) const
+  {
+    return std::hash<std::string_view>{}(s);
+  }
+
+  std::size_t operator()(const char* s) const
+  {
+    return std::hash<std::string_view>{}(s);
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_TRANSPARENTLOOKUP_H */
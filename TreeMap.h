@@ -3,13 +3,29 @@
 
 #include <cstddef>
 #include <initializer_list>
+#include <iterator>
 #include <stdexcept>
 #include <utility>
+#include <type_traits>
+#include <new>
+#include <functional>
+
+#include "NodePool.h"
+#include "TransparentLookup.h"
+#include "Instrumentation.h"
 
 namespace aisdi
 {
 
-template <typename KeyType, typename ValueType>
+/* node-level access for the coroutine lookups of InterleavedLookup.h */
+template <typename Map>
+struct LookupAccess;
+
+template <typename KeyType,
+          typename ValueType,
+          typename Compare = std::less<KeyType>,
+          typename NodePolicy = HeapNodes,
+          typename Instrumentation = NoInstrumentation>
 class TreeMap
 {
 public:
@@ -31,17 +47,23 @@ private:
   {
     value_type data;
     size_type height;
+    /* entries in the subtree of the node, the end() sentinel does not count */
+    size_type count;
 
     Node *left;
     Node *right;
     Node *parent;
 
     Node()
-      :height(0), left(nullptr), right(nullptr), parent(nullptr)
+      :height(0), count(0), left(nullptr), right(nullptr), parent(nullptr)
       {}
 
-    Node(const value_type arg)
-      :data(arg) {}
+    struct InPlace {};
+
+    /* the entry is built from args right in the node, links are set by attachNode */
+    template <typename... Args>
+    Node(InPlace, Args&&... args)
+      :data(std::forward<Args>(args)...) {}
   };
 
   Node *root;
@@ -50,29 +72,490 @@ private:
 
   size_type Size;
 
-public:
+  using NodePool = typename NodePolicy::template Pool<Node>;
+  NodePool pool;
 
-  /******************* Node methods *************************/
+  Compare comp;
 
-  Node* makeEmpty(Node* t)
+  friend struct LookupAccess<TreeMap>;
+
+  /* counters may change in const lookups */
+  mutable Instrumentation instr;
+
+  /* lookups by other key types are only offered when Compare handles them */
+  template <typename K>
+  using IfTransparent = typename std::enable_if<IsTransparent<Compare>::value
+                                                && !std::is_convertible<const K&, const_iterator>::value, K>::type;
+
+  template <typename... Args>
+  Node *createNode(Args&&... args)
+  {
+    void *location = pool.allocate();
+    try
+    {
+      return new (location) Node(typename Node::InPlace(), std::forward<Args>(args)...);
+    }
+    catch(...)
+    {
+      pool.deallocate(static_cast<Node*>(location));
+      throw;
+    }
+  }
+
+  void destroyNode(Node *t)
+  {
+    t->~Node();
+    pool.deallocate(t);
+  }
+
+  /* destroys the subtree; with a slab pool the memory itself goes back in makeEmpty */
+  void destroySubtree(Node *t)
+  {
+    if(t == nullptr || t == last)
+      return;
+
+    destroySubtree(t->left);
+    destroySubtree(t->right);
+    if(NodePool::bulkRelease)
+      t->~Node();
+    else
+      destroyNode(t);
+  }
+
+  template <typename K>
+  Node *valueNode(const K& key) const
   {
+    typename Instrumentation::Scope timer(instr, MapOperation::find);
+    Node *t = findN(key, root);
     if(t == nullptr)
+      throw std::out_of_range("out of range");
+    return t;
+  }
+
+  /* nullptr stands for end() */
+  const_iterator makeIterator(Node *t) const
+  {
+    const_iterator it;
+    it.cptr = t == nullptr ? last : t;
+    it.ptrTree = this;
+    return it;
+  }
+
+  template <typename K>
+  const_iterator findKey(const K& key) const
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::find);
+    return makeIterator(findN(key, root));
+  }
+
+  template <typename K>
+  void removeKey(const K& key)
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::remove);
+    if(Size == 0)
+      throw std::out_of_range("out of range size is 0");
+    Node *t = findN(key, root);
+    if(t == nullptr)
+      throw std::out_of_range("out of range not found");
+
+    removeNode(t);
+  }
+
+  /* first node whose key is not less than key, nullptr if there is none */
+  template <typename K>
+  Node *lowerBoundN(const K& key) const
+  {
+    Node *bound = nullptr;
+    Node *t = root;
+    while(t != nullptr && t != last)
+    {
+      if(comp(t->data.first, key))
+        t = t->right;
+      else
+      {
+        bound = t;
+        t = t->left;
+      }
+    }
+    return bound;
+  }
+
+  /* first node whose key is greater than key, nullptr if there is none */
+  template <typename K>
+  Node *upperBoundN(const K& key) const
+  {
+    Node *bound = nullptr;
+    Node *t = root;
+    while(t != nullptr && t != last)
+    {
+      if(comp(key, t->data.first))
+      {
+        bound = t;
+        t = t->left;
+      }
+      else
+        t = t->right;
+    }
+    return bound;
+  }
+
+  template <typename K>
+  const_iterator lowerBoundKey(const K& key) const
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::find);
+    return makeIterator(lowerBoundN(key));
+  }
+
+  template <typename K>
+  const_iterator upperBoundKey(const K& key) const
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::find);
+    return makeIterator(upperBoundN(key));
+  }
+
+  /* in-order successor of an entry; the maximum is followed by the end() sentinel */
+  Node *nextNode(Node *t) const
+  {
+    if(t->right != nullptr)
+    {
+      t = t->right;
+      while(t->left != nullptr)
+        t = t->left;
+      return t;
+    }
+
+    /* climb while coming from a right subtree, the key order is not needed */
+    while(t->parent->right == t)
+      t = t->parent;
+    return t->parent;
+  }
+
+  /* calls fn on the entries with keys in [lo, hi): one descent, then successor links */
+  template <typename Fn>
+  void forEachInRange(const key_type& lo, const key_type& hi, Fn& fn) const
+  {
+    Node *t;
+    {
+      typename Instrumentation::Scope timer(instr, MapOperation::find);
+      t = lowerBoundN(lo);
+    }
+    for(; t != nullptr && t != last && comp(t->data.first, hi); t = nextNode(t))
+      fn(t->data);
+  }
+
+  /* number of entries with keys less than key, summing left subtrees on the way down */
+  template <typename K>
+  size_type rankN(const K& key) const
+  {
+    size_type rank = 0;
+    Node *t = root;
+    while(t != nullptr && t != last)
+    {
+      if(comp(t->data.first, key))
+      {
+        rank += countOf(t->left) + 1;
+        t = t->right;
+      }
+      else
+        t = t->left;
+    }
+    return rank;
+  }
+
+  /* the entry with index entries before it; index must be less than Size */
+  Node *selectN(size_type index) const
+  {
+    Node *t = root;
+    for(;;)
+    {
+      size_type before = countOf(t->left);
+      if(index < before)
+        t = t->left;
+      else if(index == before)
+        return t;
+      else
+      {
+        index -= before + 1;
+        t = t->right;
+      }
+    }
+  }
+
+  const_iterator selectIndex(size_type index) const
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::find);
+    if(index >= Size)
+      throw std::out_of_range("out of range");
+    return makeIterator(selectN(index));
+  }
+
+  /*
+    Links the next count entries of it into a perfectly balanced subtree
+    and returns its root: the middle entry on top, the halves below. In
+    key order, so every node is created once and nothing is compared.
+  */
+  template <typename It>
+  Node *buildSorted(It& it, size_type count)
+  {
+    if(count == 0)
       return nullptr;
+
+    const size_type leftCount = count / 2;
+    Node *left = buildSorted(it, leftCount);
+    Node *t;
+    try
+    {
+      t = createNode(*it);
+    }
+    catch(...)
+    {
+      destroySubtree(left);
+      throw;
+    }
+    ++it;
+
+    Node *right;
+    try
+    {
+      right = buildSorted(it, count - leftCount - 1);
+    }
+    catch(...)
+    {
+      destroySubtree(left);
+      destroyNode(t);
+      throw;
+    }
+
+    t->left = left;
+    t->right = right;
+    t->parent = nullptr;
+    if(left != nullptr)
+      left->parent = t;
+    if(right != nullptr)
+      right->parent = t;
+    t->height = max(height(left), height(right)) + 1;
+    t->count = count;
+    return t;
+  }
+
+  /* fills the empty map with count entries in ascending key order */
+  template <typename It>
+  void assignSorted(It first, size_type count)
+  {
+    pool.reserve(count);
+    root = buildSorted(first, count);
+    Size = count;
+    linkEnd();
+  }
+
+  template <typename It>
+  bool strictlyAscending(It first, It last) const
+  {
+    if(first == last)
+      return true;
+    for(It prev = first++; first != last; prev = first++)
+    {
+      if(!comp(prev->first, first->first))
+        return false;
+    }
+    return true;
+  }
+
+  /* puts to where from hangs below parent, or makes it the root */
+  void replaceChild(Node *parent, Node *from, Node *to)
+  {
+    if(parent == nullptr)
+      root = to;
+    else if(parent->left == from)
+      parent->left = to;
+    else
+      parent->right = to;
+    if(to != nullptr)
+      to->parent = parent;
+  }
+
+  /* restores the AVL balance at t after a change below it, returns the root of the subtree */
+  Node *rebalance(Node *t)
+  {
+    Node *parent = t->parent;
+    Node *top = t;
+    if(height(t->left) - height(t->right) == 2)
+    {
+      if(height(t->left->left) >= height(t->left->right))
+        top = rotateWithLeftChild(t);
+      else
+        top = doubleWithLeftChild(t);
+    }
+    else if(height(t->right) - height(t->left) == 2)
+    {
+      if(height(t->right->right) >= height(t->right->left))
+        top = rotateWithRightChild(t);
+      else
+        top = doubleWithRightChild(t);
+    }
     else
     {
-        makeEmpty(t->left);
-        makeEmpty(t->right);
-        delete t;
+      t->height = max(height(t->left), height(t->right)) + 1;
+      updateCount(t);
+    }
+    if(top != t)
+      replaceChild(parent, t, top);
+    return top;
+  }
+
+  /*
+    The node with key, or nullptr and the node a new entry with key would
+    hang below (nullptr for an empty tree) and on which side. One descent
+    serves both the lookup and the insertion.
+  */
+  template <typename K>
+  Node *findSlot(const K& key, Node *&parent, bool &left) const
+  {
+    parent = nullptr;
+    left = false;
+    Node *t = root;
+    while(t != nullptr && t != last)
+    {
+      if(comp(key, t->data.first))
+        left = true;
+      else if(comp(t->data.first, key))
+        left = false;
+      else
+        return t;
+      parent = t;
+      t = left ? t->left : t->right;
+    }
+    return nullptr;
+  }
+
+  /*
+    Links the new node n where findSlot left off, then fixes heights and
+    rebalances bottom-up through the parent links, stopping at the first
+    subtree whose height did not change: at most one (double) rotation,
+    after which only the subtree counts above grow by one. The end()
+    sentinel is unhooked meanwhile.
+  */
+  void attachNode(Node *n, Node *parent, bool left)
+  {
+    if(last->parent != nullptr)
+      last->parent->right = nullptr;
+
+    n->height = 0;
+    n->count = 1;
+    n->left = n->right = nullptr;
+    n->parent = parent;
+    if(parent == nullptr)
+      root = n;
+    else if(left)
+      parent->left = n;
+    else
+      parent->right = n;
+    Size++;
+
+    Node *from = parent;
+    while(from != nullptr)
+    {
+      size_type before = from->height;
+      Node *top = rebalance(from);
+      if(top == from && top->height == before)
+        break;
+      from = top->parent;
     }
+    for(; from != nullptr; from = from->parent)
+      updateCount(from);
+    linkEnd();
+  }
+
+  /*
+    Unlinks t and frees it. A node with two children is replaced by its
+    successor node, relinked by pointers, so no entry is copied or moved
+    and iterators to other entries stay valid. Heights are fixed and the
+    tree rebalanced bottom-up, stopping at the first subtree whose height
+    did not change; above it only the subtree counts drop by one. The
+    end() sentinel is unhooked meanwhile.
+  */
+  void removeNode(Node *t)
+  {
+    if(last->parent != nullptr)
+      last->parent->right = nullptr;
+
+    Node *from;
+    if(t->left != nullptr && t->right != nullptr)
+    {
+      Node *next = findMin(t->right);
+      if(next->parent == t)
+      {
+        from = next;
+      }
+      else
+      {
+        from = next->parent;
+        replaceChild(from, next, next->right);
+        next->right = t->right;
+        t->right->parent = next;
+      }
+      next->left = t->left;
+      t->left->parent = next;
+      next->height = t->height;
+      replaceChild(t->parent, t, next);
+    }
+    else
+    {
+      from = t->parent;
+      replaceChild(from, t, t->left != nullptr ? t->left : t->right);
+    }
+    destroyNode(t);
+    Size--;
+
+    while(from != nullptr)
+    {
+      size_type before = from->height;
+      Node *top = rebalance(from);
+      if(top == from && top->height == before)
+        break;
+      from = top->parent;
+    }
+    for(; from != nullptr; from = from->parent)
+      updateCount(from);
+    linkEnd();
+  }
+
+public:
+
+  /******************* Node methods *************************/
+
+  /*
+    Removes all nodes, the end sentinel stays. With a slab pool and
+    trivially destructible entries no traversal is needed at all.
+  */
+  Node* makeEmpty(Node* t)
+  {
+    if(!(NodePool::bulkRelease && std::is_trivially_destructible<value_type>::value))
+      destroySubtree(t);
+    pool.release();
+
     if(last != nullptr)
-      last = nullptr;
+      last->parent = nullptr;
+    first = last;
     Size = 0;
     return nullptr;
   }
 
+  /* the end() sentinel hanging off the maximum does not count */
   int height(Node *t)
   {
-    return t == nullptr ? -1 : t->height;
+    return t == nullptr || t == last ? -1 : t->height;
+  }
+
+  /* entries in the subtree of t, 0 for nullptr and the end() sentinel */
+  size_type countOf(const Node *t) const
+  {
+    return t == nullptr || t == last ? 0 : t->count;
+  }
+
+  void updateCount(Node *t)
+  {
+    t->count = countOf(t->left) + countOf(t->right) + 1;
   }
 
       /* Function to max of left/right node */
@@ -84,9 +567,17 @@ public:
   void insertForTest(size_type number_of_elements)
   {
     for(size_t i = 0; i < number_of_elements; ++i)
+      tryEmplaceT(static_cast<key_type>(i), "Item");
+  }
+
+  /* after inserts: the maximum leads to the end() sentinel again and first is the minimum */
+  void linkEnd()
+  {
+    if(root == nullptr)
     {
-      value_type data(i, "Item");
-      root = insert(data, root, nullptr);
+      first = last;
+      last->parent = nullptr;
+      return;
     }
     first = findMax(root);
     first->right = last;
@@ -94,58 +585,10 @@ public:
     first = findMin(root);
   }
 
-     /* Function to insert data recursively */
-  Node *insert(value_type data, Node *t, Node *parent)
-  {
-    if (t == nullptr)
-    {
-       t = new Node(data);
-       t->height = 0;
-       t->right = t->left = nullptr;
-       t->parent = parent;
-       Size++;
-    }
-    else if (data.first < t->data.first)
-    {
-        t->left = insert(data, t->left, t);
-        if (height(t->left) - height(t->right) == 2)
-        {
-          if (data.first < t->left->data.first)
-          {
-             t = rotateWithLeftChild(t);
-          }
-          else
-          {
-             t = doubleWithLeftChild(t);
-          }
-        }
-     }
-    else if (data.first > t->data.first)
-    {
-      if(t->right == last)
-        t->right = insert(data, nullptr, t);
-      else
-        t->right = insert(data, t->right, t);
-
-      if (height(t->right) - height(t->left) == 2)
-      {
-        if (data.first > t->right->data.first)
-        {
-          t = rotateWithRightChild(t);
-        }
-        else
-        {
-          t = doubleWithRightChild(t);
-        }
-      }
-    }
-    t->height = max(height(t->left), height(t->right)) + 1;
-    return t;
-  }
-
     /* Rotate binary tree node with left child */
   Node *rotateWithLeftChild(Node* k2)
   {
+   instr.rotated();
    Node *k1 = k2->left;
    k2->left = k1->right;
    if(k1->right != nullptr)
@@ -157,12 +600,15 @@ public:
 
    k2->height = max(height(k2->left), height(k2->right)) + 1;
    k1->height = max(height(k1->left), k2->height) + 1;
+   updateCount(k2);
+   updateCount(k1);
    return k1;
   }
 
      /* Rotate binary tree node with right child */
   Node *rotateWithRightChild(Node *k1)
   {
+   instr.rotated();
    Node *k2 = k1->right;
    k1->right = k2->left;
    if(k2->left != nullptr)
@@ -174,6 +620,8 @@ public:
 
    k1->height = max(height(k1->left), height(k1->right)) + 1;
    k2->height = max(height(k2->right), k1->height) + 1;
+   updateCount(k1);
+   updateCount(k2);
    return k2;
   }
 
@@ -237,115 +685,29 @@ public:
     return t;
   }
 
-    /* Remove Node */
-  Node *removeN(const key_type key, Node *t)
+  /* removes key from the subtree of t if it is there, returns the root */
+  template <typename K>
+  Node *removeN(const K& key, Node *t)
   {
-    Node *tmp;
-    if(t == nullptr || t == last)
-      return nullptr;
-
-    else if(key < t->data.first)
-    {
-      t->left = removeN(key, t->left);
-    }
-    else if(key > t->data.first)
-    {
-      t->right = removeN(key, t->right);
-    }
+    Node *found = findN(key, t);
+    if(found != nullptr)
+      removeNode(found);
+    return root;
+  }
 
-    else
+  template <typename K>
+  Node *findN(const K& key, Node *t) const
+  {
+    while(t != nullptr && t != last)
     {
-      if(t->left == nullptr)
-      {
-        if(t->right == last)
-        {
-          if(t == root)
-            root = nullptr;
-
-          delete t;
-          return last;
-        }
-        tmp = t;
-        if(t == root)
-          root = t->right;
-
-        t = t->right;
-        delete tmp;
-        return t;
-      }
-      else if(t->right == last)
-      {
-        tmp = t;
-        if(t == root)
-          root = t->left;
-
+      if(comp(key, t->data.first))
         t = t->left;
-        t->right = last;
-        delete tmp;
-        return t;
-      }
-
-      tmp = findMin(t->right);
-      if(tmp != nullptr)
-      {
-        Node *_node = new Node(tmp->data);
-        if(t == root)
-        {
-          root = _node;
-          _node->parent = nullptr;
-        }
-        else
-        {
-          if(t->parent->right == t)
-          {
-            t->parent->right = _node;
-          }
-          if(t->parent->left == t)
-          {
-            t->parent->left = _node;
-          }
-          _node->parent = t->parent;
-        }
-        _node->left = t->left;
-        t->left->parent = _node;
-        _node->right = removeN(tmp->data.first, t->right);
-
-        delete t;
-        return _node;
-      }
+      else if(comp(t->data.first, key))
+        t = t->right;
       else
-      {
-        if(t->left != nullptr)
-        {
-          if(t->parent->right == t)
-          {
-            t->parent->right = t->left;
-          }
-          if(t->parent->left == t)
-          {
-            t->parent->left = t->left;
-          }
-          t->left->parent = t->parent;
-          delete t;
-          return t->left;
-        }
-        delete t;
-        return nullptr;
-      }
+        return t;
     }
-    return t;
-  }
-
-  Node *findN(const key_type key, Node *t) const
-  {
-    if(t == nullptr || t == last)
-      return nullptr;
-    else if(key < t->data.first)
-      return findN(key, t->left);
-    else if(key > t->data.first)
-      return findN(key, t->right);
-    else
-      return t;
+    return nullptr;
   }
 
 
@@ -369,33 +731,44 @@ public:
   TreeMap(std::initializer_list<value_type> list)
     :TreeMap()
   {
+    if(strictlyAscending(list.begin(), list.end()))
+    {
+      assignSorted(list.begin(), list.size());
+      return;
+    }
     for( auto it = list.begin(); it != list.end(); ++it )
-      root = insert(*it, root, nullptr);
+      tryEmplaceT(it->first, it->second);
+  }
 
-    first = findMax(root);
-    first->right = last;
-    last->parent = first;
-    first = findMin(root);
+  /*
+    Builds the map from entries in ascending key order in O(n), with no
+    rotations: the tree comes out perfectly balanced. Input that turns out
+    not to be strictly ascending is inserted one entry at a time instead.
+  */
+  template <typename ForwardIt>
+  static TreeMap from_sorted(ForwardIt first, ForwardIt last)
+  {
+    TreeMap map;
+    if(map.strictlyAscending(first, last))
+    {
+      map.assignSorted(first, static_cast<size_type>(std::distance(first, last)));
+      return map;
+    }
+    for(; first != last; ++first)
+      map.tryEmplaceT(first->first, first->second);
+    return map;
   }
 
+  /* other is in key order already, so the copy is built in O(n) */
   TreeMap(const TreeMap& other)
     :TreeMap()
   {
-
     if(other.root != nullptr)
-    {
-      for( auto it = other.begin(); it != other.end(); ++it )
-      {
-          root = insert(*it, root, nullptr);
-      }
-      first = findMax(root);
-      first->right = last;
-      last->parent = first;
-      first = findMin(root);
-    }
+      assignSorted(other.begin(), other.Size);
   }
 
   TreeMap(TreeMap&& other)
+    :pool(std::move(other.pool))
   {
     root = other.root;
     first = other.first;
@@ -415,19 +788,8 @@ public:
     }
 
       root = makeEmpty(root);
-      last = new Node();
-
-      for( auto it = other.begin(); it != other.end(); ++it )
-      {
-          root = insert(*it, root, nullptr);
-      }
-      if(root != nullptr)
-      {
-        first = findMax(root);
-        first->right = last;
-        last->parent = first;
-        first = findMin(root);
-      }
+      if(other.root != nullptr)
+        assignSorted(other.begin(), other.Size);
       return *this;
   }
 
@@ -438,6 +800,8 @@ public:
       return *this;
     }
       root = makeEmpty(root);
+      delete last;
+      pool = std::move(other.pool);
       root = other.root;
       first = other.first;
       last = other.last;
@@ -462,110 +826,289 @@ public:
     }
   }
 
-  mapped_type& operator[](const key_type& key)
+  /* looks key up once; only a missing key is copied or moved into a new node, with a value built from args */
+  template <typename K, typename... Args>
+  std::pair<iterator, bool> tryEmplaceT(K&& key, Args&&... args)
   {
-    Node *t = findN(key, root);
-    if(t == nullptr)
+    Node *parent;
+    bool left;
+    Node *t = findSlot(key, parent, left);
+    if(t != nullptr)
+      return std::pair<iterator, bool>(iterator(makeIterator(t)), false);
+
+    t = createNode(std::piecewise_construct,
+                   std::forward_as_tuple(std::forward<K>(key)),
+                   std::forward_as_tuple(std::forward<Args>(args)...));
+    attachNode(t, parent, left);
+    return std::pair<iterator, bool>(iterator(makeIterator(t)), true);
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args)
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::insert);
+    return tryEmplaceT(key, std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args)
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::insert);
+    return tryEmplaceT(std::move(key), std::forward<Args>(args)...);
+  }
+
+  /* the entry is built first to learn its key, and dropped again if the key is taken */
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args)
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::insert);
+    Node *t = createNode(std::forward<Args>(args)...);
+    Node *parent;
+    bool left;
+    Node *found = findSlot(t->data.first, parent, left);
+    if(found != nullptr)
     {
-      value_type _data(key, mapped_type());
-      root = insert(_data, root, nullptr);
-      t = findN(key, root);
-      first = findMax(root);
-      first->right = last;
-      last->parent = first;
-      first = findMin(root);
+      destroyNode(t);
+      return std::pair<iterator, bool>(iterator(makeIterator(found)), false);
     }
+    attachNode(t, parent, left);
+    return std::pair<iterator, bool>(iterator(makeIterator(t)), true);
+  }
+
+  /* the key of a value_type is const, so it is copied even from an rvalue; the value is moved */
+  std::pair<iterator, bool> insert(const value_type& item)
+  {
+    return try_emplace(item.first, item.second);
+  }
+
+  std::pair<iterator, bool> insert(value_type&& item)
+  {
+    return try_emplace(item.first, std::move(item.second));
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& obj)
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::insert);
+    auto result = tryEmplaceT(key, std::forward<M>(obj));
+    if(!result.second)
+      result.first->second = std::forward<M>(obj);
+    return result;
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& obj)
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::insert);
+    auto result = tryEmplaceT(std::move(key), std::forward<M>(obj));
+    if(!result.second)
+      result.first->second = std::forward<M>(obj);
+    return result;
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::subscript);
+    return tryEmplaceT(key).first->second;
+  }
 
-    return t->data.second;
+  mapped_type& operator[](key_type&& key)
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::subscript);
+    return tryEmplaceT(std::move(key)).first->second;
   }
 
   const mapped_type& valueOf(const key_type& key) const
   {
-    if(findN(key, root) == nullptr)
-    {
-      throw std::out_of_range("out of range");
-    }
-    else
-    {
-      return findN(key, root)->data.second;
-    }
+    return valueNode(key)->data.second;
   }
 
   mapped_type& valueOf(const key_type& key)
   {
-    if(findN(key, root) == nullptr)
-    {
-      throw std::out_of_range("out of range");
-    }
-    else
-    {
-      return findN(key, root)->data.second;
-    }
+    return valueNode(key)->data.second;
   }
 
-  const_iterator find(const key_type& key) const
+  template <typename K, typename = IfTransparent<K>>
+  const mapped_type& valueOf(const K& key) const
   {
-    Node *t = findN(key, root);
-    if(t == nullptr)
-    {
-       t = last;
-    }
-    const_iterator it;
-    it.cptr = t;
-    it.ptrTree = this;
+    return valueNode(key)->data.second;
+  }
 
-    return it;
+  template <typename K, typename = IfTransparent<K>>
+  mapped_type& valueOf(const K& key)
+  {
+    return valueNode(key)->data.second;
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    return findKey(key);
   }
 
   iterator find(const key_type& key)
   {
-    //const_iterator it = find(key);
+    return iterator(findKey(key));
+  }
 
-	Node* t = findN(key, root);
+  template <typename K, typename = IfTransparent<K>>
+  const_iterator find(const K& key) const
+  {
+    return findKey(key);
+  }
 
-    if(t == nullptr)
-    {
-       t = last;
-    }
-    const_iterator it;
-    it.cptr = t;
-    it.ptrTree = this;
+  template <typename K, typename = IfTransparent<K>>
+  iterator find(const K& key)
+  {
+    return iterator(findKey(key));
+  }
+
+  bool contains(const key_type& key) const
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::find);
+    return findN(key, root) != nullptr;
+  }
+
+  template <typename K, typename = IfTransparent<K>>
+  bool contains(const K& key) const
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::find);
+    return findN(key, root) != nullptr;
+  }
+
+  /* first entry with a key not less than key, or end() */
+  const_iterator lower_bound(const key_type& key) const
+  {
+    return lowerBoundKey(key);
+  }
+
+  iterator lower_bound(const key_type& key)
+  {
+    return iterator(lowerBoundKey(key));
+  }
+
+  template <typename K, typename = IfTransparent<K>>
+  const_iterator lower_bound(const K& key) const
+  {
+    return lowerBoundKey(key);
+  }
+
+  template <typename K, typename = IfTransparent<K>>
+  iterator lower_bound(const K& key)
+  {
+    return iterator(lowerBoundKey(key));
+  }
+
+  /* first entry with a key greater than key, or end() */
+  const_iterator upper_bound(const key_type& key) const
+  {
+    return upperBoundKey(key);
+  }
+
+  iterator upper_bound(const key_type& key)
+  {
+    return iterator(upperBoundKey(key));
+  }
+
+  template <typename K, typename = IfTransparent<K>>
+  const_iterator upper_bound(const K& key) const
+  {
+    return upperBoundKey(key);
+  }
+
+  template <typename K, typename = IfTransparent<K>>
+  iterator upper_bound(const K& key)
+  {
+    return iterator(upperBoundKey(key));
+  }
+
+  /* the entries with key: empty or the single one, as keys are unique */
+  std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const
+  {
+    return std::make_pair(lowerBoundKey(key), upperBoundKey(key));
+  }
+
+  std::pair<iterator, iterator> equal_range(const key_type& key)
+  {
+    return std::make_pair(iterator(lowerBoundKey(key)), iterator(upperBoundKey(key)));
+  }
+
+  template <typename K, typename = IfTransparent<K>>
+  std::pair<const_iterator, const_iterator> equal_range(const K& key) const
+  {
+    return std::make_pair(lowerBoundKey(key), upperBoundKey(key));
+  }
+
+  template <typename K, typename = IfTransparent<K>>
+  std::pair<iterator, iterator> equal_range(const K& key)
+  {
+    return std::make_pair(iterator(lowerBoundKey(key)), iterator(upperBoundKey(key)));
+  }
+
+  /*
+    Calls fn(entry) for every entry with a key in [lo, hi), in key order,
+    in O(log n + k). fn must not insert into or remove from the map.
+  */
+  template <typename Fn>
+  void for_each_in_range(const key_type& lo, const key_type& hi, Fn fn) const
+  {
+    auto visit = [&fn](const value_type& item) { fn(item); };
+    forEachInRange(lo, hi, visit);
+  }
+
+  template <typename Fn>
+  void for_each_in_range(const key_type& lo, const key_type& hi, Fn fn)
+  {
+    forEachInRange(lo, hi, fn);
+  }
+
+  /* number of entries with keys less than key, in O(log n) */
+  size_type rank(const key_type& key) const
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::find);
+    return rankN(key);
+  }
 
-	return iterator(it);
+  /* the entry at position index in key order, counting from 0; throws if index >= getSize() */
+  const_iterator select(size_type index) const
+  {
+    return selectIndex(index);
+  }
+
+  iterator select(size_type index)
+  {
+    return iterator(selectIndex(index));
+  }
+
+  /* number of entries with keys in [lo, hi), in O(log n) whatever their number */
+  size_type count_range(const key_type& lo, const key_type& hi) const
+  {
+    typename Instrumentation::Scope timer(instr, MapOperation::find);
+    if(!comp(lo, hi))
+      return 0;
+    return rankN(hi) - rankN(lo);
   }
 
   void remove(const key_type& key)
   {
-    if(Size == 0)
-      throw std::out_of_range("out of range size is 0");
-    else
-    {
-      Node *t = findN(key, root);
-      if(t == nullptr)
-        throw std::out_of_range("out of range not found");
-      else
-        removeN(key, root);
+    removeKey(key);
+  }
 
-      first = findMin(root);
-      Size--;
-    }
+  template <typename K, typename = IfTransparent<K>>
+  void remove(const K& key)
+  {
+    removeKey(key);
   }
 
+  /* the iterator already holds the node, so there is no search */
   void remove(const const_iterator& it)
   {
+    typename Instrumentation::Scope timer(instr, MapOperation::remove);
 
     if(Size == 0)
       throw std::out_of_range("out of range size is 0");
-    else
-    {
-      Node *t = findN(it->first, root);
-      if(t == nullptr)
-        throw std::out_of_range("out of range not found");
-      else
-      removeN(it->first, root);
-      first = findMin(root);
-      Size--;
-    }
+    if(it.ptrTree != this || it.cptr == nullptr || it.cptr == last)
+      throw std::out_of_range("out of range not found");
+    removeNode(it.cptr);
   }
 
   size_type getSize() const
@@ -573,6 +1116,34 @@ public:
     return Size;
   }
 
+  /* bytes the map holds, see MemoryUsage; a tree has no bucket array */
+  MemoryUsage memory_usage() const
+  {
+    MemoryUsage m;
+    m.objectBytes = sizeof(*this);
+    m.bucketBytes = 0;
+    m.nodeBytes = Size * sizeof(Node);
+    m.overheadBytes = pool.overheadBytes(Size);
+    if(last != nullptr)
+    {
+      m.nodeBytes += sizeof(Node);
+      m.overheadBytes += allocationOverhead(sizeof(Node));
+    }
+    m.payloadBytes = Size * sizeof(value_type);
+    return m;
+  }
+
+  /* counters of the Instrumentation policy */
+  const Instrumentation& instrumentation() const
+  {
+    return instr;
+  }
+
+  Instrumentation& instrumentation()
+  {
+    return instr;
+  }
+
   Node *getRoot()
   {
     return root;
@@ -637,8 +1208,8 @@ public:
   }
 };
 
-template <typename KeyType, typename ValueType>
-class TreeMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Compare, typename NodePolicy, typename Instrumentation>
+class TreeMap<KeyType, ValueType, Compare, NodePolicy, Instrumentation>::ConstIterator
 {
 
   friend class TreeMap;
@@ -650,8 +1221,8 @@ public:
   using pointer = const typename TreeMap::value_type*;
 
 private:
-  TreeMap<KeyType, ValueType>::Node *cptr;
-  const TreeMap<KeyType, ValueType> *ptrTree;
+  typename TreeMap::Node *cptr;
+  const TreeMap *ptrTree;
 
 public:
 
@@ -668,32 +1239,15 @@ public:
     ptrTree = other.ptrTree;
   }
 
+  ConstIterator& operator=(const ConstIterator& other) = default;
+
   ConstIterator& operator++()
   {
-      if(cptr->right != nullptr)
-      {
-         cptr = cptr->right;
-         if(cptr->left != nullptr)
-          cptr = ptrTree->findMin(cptr->left);
-      }
-      else if(cptr == ptrTree->last)
-      {
+    typename Instrumentation::Scope timer(ptrTree->instr, MapOperation::iterate);
+      if(cptr == ptrTree->last)
         throw std::out_of_range("out of range (on last)");
-      }
-      else
-      {
-        if(cptr->parent->data.first > cptr->data.first)
-        {
-          cptr = cptr->parent;
-        }
-        else
-        {
-          while(cptr->data.first > cptr->parent->data.first)
-            cptr = cptr->parent;
 
-          cptr = cptr->parent;
-        }
-      }
+      cptr = ptrTree->nextNode(cptr);
       return *this;
   }
 
@@ -707,6 +1261,7 @@ public:
 
   ConstIterator& operator--()
   {
+    typename Instrumentation::Scope timer(ptrTree->instr, MapOperation::iterate);
     if(cptr->left != nullptr)
     {
        cptr = cptr->left;
@@ -722,13 +1277,9 @@ public:
       {
         cptr = cptr->parent;
       }
-      else if(cptr->parent->data.first < cptr->data.first)
-      {
-        cptr = cptr->parent;
-      }
       else
       {
-        while(cptr->data.first < cptr->parent->data.first)
+        while(cptr->parent->left == cptr)
           cptr = cptr->parent;
 
         cptr = cptr->parent;
@@ -768,8 +1319,8 @@ public:
   }
 };
 
-template <typename KeyType, typename ValueType>
-class TreeMap<KeyType, ValueType>::Iterator : public TreeMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Compare, typename NodePolicy, typename Instrumentation>
+class TreeMap<KeyType, ValueType, Compare, NodePolicy, Instrumentation>::Iterator : public TreeMap<KeyType, ValueType, Compare, NodePolicy, Instrumentation>::ConstIterator
 {
 public:
   using reference = typename TreeMap::reference;
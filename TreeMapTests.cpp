@@ -0,0 +1,538 @@
+#include <TreeMap.h>
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+namespace
+{
+
+class OperationCountingObject
+{
+public:
+  OperationCountingObject(int value_ = 0)
+    : value(value_)
+  {
+    ++constructedObjects;
+  }
+
+  OperationCountingObject(const OperationCountingObject& other)
+    : value(other.value)
+  {
+    ++constructedObjects;
+    ++copiedObjects;
+  }
+
+  OperationCountingObject(OperationCountingObject&& other)
+    : value(other.value)
+  {
+    ++constructedObjects;
+    ++movedObjects;
+  }
+
+  ~OperationCountingObject()
+  {
+    ++destroyedObjects;
+  }
+
+  OperationCountingObject& operator=(const OperationCountingObject& other)
+  {
+    ++assignedObjects;
+    value = other.value;
+    return *this;
+  }
+
+  OperationCountingObject& operator=(OperationCountingObject&& other)
+  {
+    ++assignedObjects;
+    ++movedObjects;
+    value = other.value;
+    return *this;
+  }
+
+  operator int() const
+  {
+    return value;
+  }
+
+  static void resetCounters()
+  {
+    constructedObjects = 0;
+    destroyedObjects = 0;
+    copiedObjects = 0;
+    movedObjects = 0;
+    assignedObjects = 0;
+  }
+
+  static std::size_t constructedObjectsCount()
+  {
+    return constructedObjects;
+  }
+
+  static std::size_t copiedObjectsCount()
+  {
+    return copiedObjects;
+  }
+
+  static std::size_t movedObjectsCount()
+  {
+    return movedObjects;
+  }
+
+private:
+  int value;
+
+  static std::size_t constructedObjects;
+  static std::size_t destroyedObjects;
+  static std::size_t copiedObjects;
+  static std::size_t movedObjects;
+  static std::size_t assignedObjects;
+};
+
+std::size_t OperationCountingObject::constructedObjects = 0;
+std::size_t OperationCountingObject::destroyedObjects = 0;
+std::size_t OperationCountingObject::copiedObjects = 0;
+std::size_t OperationCountingObject::movedObjects = 0;
+std::size_t OperationCountingObject::assignedObjects = 0;
+
+std::ostream& operator<<(std::ostream& out, const OperationCountingObject& obj)
+{
+  return out << '<' << static_cast<int>(obj) << '>';
+}
+
+struct Fixture
+{
+  Fixture()
+  {
+    OperationCountingObject::resetCounters();
+  }
+};
+
+} // namespace
+
+template <typename K>
+using Map = aisdi::TreeMap<K, std::string>;
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t, OperationCountingObject>;
+
+BOOST_FIXTURE_TEST_SUITE(TreeMapTests, Fixture)
+
+template <typename K>
+void thenMapContainsItems(const Map<K>& map,
+                          const std::map<K, std::string>& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  auto it = map.begin();
+  for (const auto& item : expected)
+  {
+    BOOST_REQUIRE_MESSAGE(it != map.end(), "Missing required item with key: " << item.first);
+    BOOST_CHECK_EQUAL(it->first, item.first);
+    BOOST_CHECK_EQUAL(it->second, item.second);
+    ++it;
+  }
+  BOOST_CHECK(it == map.end());
+}
+
+template <typename T>
+void thenCopiedObjectsCountWas(std::size_t count)
+{
+  (void) count;
+  // unable to check it (in a simple way) for all objects, hence template specialization.
+}
+
+template <typename T>
+void thenMovedObjectsCountWas(std::size_t count)
+{
+  (void) count;
+  // unable to check it (in a simple way) for all objects, hence template specialization.
+}
+
+template <>
+void thenCopiedObjectsCountWas<OperationCountingObject>(std::size_t count)
+{
+  BOOST_CHECK_EQUAL(OperationCountingObject::copiedObjectsCount(), count);
+}
+
+template <>
+void thenMovedObjectsCountWas<OperationCountingObject>(std::size_t count)
+{
+  BOOST_CHECK_EQUAL(OperationCountingObject::movedObjectsCount(), count);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenAddingItemsInAnyOrder_ThenTheyAreIteratedInKeyOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  BOOST_CHECK(map.begin() == map.end());
+
+  for (int key : { 5, 1, 9, 3, 7, 2, 8 })
+    map[key] = std::to_string(key);
+
+  thenMapContainsItems(map, { { 1, "1" }, { 2, "2" }, { 3, "3" }, { 5, "5" },
+                              { 7, "7" }, { 8, "8" }, { 9, "9" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenTryEmplacing_ThenExistingValueIsKept,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" } };
+
+  auto inserted = map.try_emplace(27, "Bob");
+  auto existing = map.try_emplace(42, "Chuck");
+
+  BOOST_CHECK(inserted.second);
+  BOOST_CHECK(inserted.first == map.find(27));
+  BOOST_CHECK(!existing.second);
+  BOOST_CHECK_EQUAL(existing.first->second, "Alice");
+  thenMapContainsItems(map, { { 27, "Bob" }, { 42, "Alice" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenInsertingOrAssigning_ThenValueIsReplaced,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" } };
+
+  BOOST_CHECK(!map.insert_or_assign(42, "Chuck").second);
+  BOOST_CHECK(map.insert_or_assign(27, "Bob").second);
+  BOOST_CHECK(map.emplace(13, "Dave").second);
+  BOOST_CHECK(!map.emplace(13, "Eve").second);
+  BOOST_CHECK(map.insert({ 7, "Frank" }).second);
+
+  thenMapContainsItems(map, { { 7, "Frank" }, { 13, "Dave" }, { 27, "Bob" }, { 42, "Chuck" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMissingKey_WhenUsingSubscript_ThenKeyIsCopiedOnce,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "x" }, { 2, "y" }, { 3, "z" } };
+  const K key(42);
+
+  OperationCountingObject::resetCounters();
+  map[key] = "Alice";
+  map[key] = "Bob";
+
+  thenCopiedObjectsCountWas<K>(1);
+  thenMovedObjectsCountWas<K>(0);
+  BOOST_CHECK_EQUAL(map.valueOf(42), "Bob");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMovedKey_WhenTryEmplacingOrEmplacing_ThenNoKeyIsCopied,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "x" }, { 2, "y" }, { 3, "z" } };
+  K key(42);
+  K other(27);
+
+  OperationCountingObject::resetCounters();
+  map.try_emplace(std::move(key), "Alice");
+  map[std::move(other)] = "Bob";
+  map.emplace(std::piecewise_construct, std::forward_as_tuple(13), std::forward_as_tuple("Chuck"));
+
+  thenCopiedObjectsCountWas<K>(0);
+  thenMovedObjectsCountWas<K>(2);
+  thenMapContainsItems(map, { { 1, "x" }, { 2, "y" }, { 3, "z" },
+                              { 13, "Chuck" }, { 27, "Bob" }, { 42, "Alice" } });
+}
+
+BOOST_AUTO_TEST_CASE(GivenRvalueItem_WhenInserting_ThenValueIsMovedNotCopied)
+{
+  aisdi::TreeMap<int, OperationCountingObject> map;
+  for (int i = 0; i < 64; ++i)
+    map.try_emplace(i, i);
+  std::pair<const int, OperationCountingObject> item(100, 27);
+
+  OperationCountingObject::resetCounters();
+  BOOST_CHECK(map.insert(std::move(item)).second);
+
+  BOOST_CHECK_EQUAL(OperationCountingObject::copiedObjectsCount(), 0);
+  BOOST_CHECK_EQUAL(OperationCountingObject::movedObjectsCount(), 1);
+  BOOST_CHECK_EQUAL(map.valueOf(100), 27);
+}
+
+BOOST_AUTO_TEST_CASE(GivenDeepTree_WhenBuildingFromList_ThenEachValueIsCopiedOnce)
+{
+  std::vector<std::pair<const int, OperationCountingObject>> items;
+  for (int i = 0; i < 8; ++i)
+    items.emplace_back(i, i);
+
+  OperationCountingObject::resetCounters();
+  aisdi::TreeMap<int, OperationCountingObject> map = { items[3], items[1], items[5], items[0],
+                                                       items[2], items[4], items[6], items[7] };
+  const std::size_t listCopies = OperationCountingObject::copiedObjectsCount();
+
+  aisdi::TreeMap<int, OperationCountingObject> copy(map);
+
+  BOOST_CHECK_EQUAL(listCopies, 16);
+  BOOST_CHECK_EQUAL(OperationCountingObject::copiedObjectsCount() - listCopies, 8);
+  BOOST_CHECK_EQUAL(OperationCountingObject::movedObjectsCount(), 0);
+  BOOST_CHECK_EQUAL(copy.getSize(), 8);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenRemovingItemsWithTwoChildren_ThenOtherItemsAndIteratorsStay,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int key = 0; key < 31; ++key)
+  {
+    map[key] = std::to_string(key);
+    expected[key] = std::to_string(key);
+  }
+  auto kept = map.find(16);
+
+  for (int key : { 15, 7, 23, 3, 11, 19, 27 })
+  {
+    map.remove(key);
+    expected.erase(key);
+  }
+  map.remove(map.find(8));
+  expected.erase(8);
+
+  BOOST_CHECK_EQUAL(kept->first, 16);
+  BOOST_CHECK_EQUAL(kept->second, "16");
+  thenMapContainsItems(map, expected);
+  std::size_t backwards = 0;
+  for (auto it = map.end(); it != map.begin(); --it)
+    ++backwards;
+  BOOST_CHECK_EQUAL(backwards, expected.size());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenRemovingEveryItem_ThenMapIsEmptyAndUsable,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 3, "c" }, { 1, "a" }, { 2, "b" } };
+
+  map.remove(2);
+  map.remove(map.begin());
+  map.remove(3);
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK_THROW(map.remove(3), std::out_of_range);
+  BOOST_CHECK_THROW(map.remove(map.end()), std::out_of_range);
+  map[5] = "e";
+  map[4] = "d";
+  thenMapContainsItems(map, { { 4, "d" }, { 5, "e" } });
+}
+
+BOOST_AUTO_TEST_CASE(GivenLargeMap_WhenRemovingMostItemsInOrder_ThenTreeStaysBalanced)
+{
+  aisdi::TreeMap<int, int> map;
+  for (int i = 0; i < 4096; ++i)
+    map[i] = i;
+
+  for (int i = 0; i < 4096 - 100; ++i)
+    map.remove(i);
+
+  /* an AVL tree of 100 nodes is at most 8 edges high, a degenerate one would be 99 */
+  BOOST_CHECK_EQUAL(map.getSize(), 100);
+  BOOST_CHECK(map.height(map.getRoot()) <= 8);
+  BOOST_CHECK_EQUAL(map.begin()->first, 3996);
+  BOOST_CHECK_EQUAL((--map.end())->first, 4095);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenRemovingItems_ThenNoValueIsCopiedOrMoved)
+{
+  aisdi::TreeMap<int, OperationCountingObject> map;
+  for (int i = 0; i < 64; ++i)
+    map.try_emplace(i, i);
+
+  OperationCountingObject::resetCounters();
+  for (int i = 0; i < 64; i += 2)
+    map.remove(i);
+
+  BOOST_CHECK_EQUAL(OperationCountingObject::constructedObjectsCount(), 0);
+  BOOST_CHECK_EQUAL(OperationCountingObject::copiedObjectsCount(), 0);
+  BOOST_CHECK_EQUAL(OperationCountingObject::movedObjectsCount(), 0);
+  BOOST_CHECK_EQUAL(map.getSize(), 32);
+  BOOST_CHECK_EQUAL(map.valueOf(33), 33);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenAskingForBounds_ThenNeighbouringItemsAreFound,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int key = 10; key <= 100; key += 10)
+    map[key] = std::to_string(key);
+  const Map<K>& constMap = map;
+
+  BOOST_CHECK_EQUAL(map.lower_bound(30)->first, 30);
+  BOOST_CHECK_EQUAL(map.lower_bound(31)->first, 40);
+  BOOST_CHECK_EQUAL(map.upper_bound(30)->first, 40);
+  BOOST_CHECK_EQUAL(constMap.lower_bound(0)->first, 10);
+  BOOST_CHECK(map.lower_bound(0) == map.begin());
+  BOOST_CHECK(map.lower_bound(101) == map.end());
+  BOOST_CHECK(constMap.upper_bound(100) == constMap.end());
+
+  auto hit = map.equal_range(50);
+  BOOST_CHECK(hit.first == map.find(50));
+  BOOST_CHECK(hit.second == map.find(60));
+  auto miss = constMap.equal_range(55);
+  BOOST_CHECK(miss.first == miss.second);
+  BOOST_CHECK_EQUAL(miss.first->first, 60);
+  Map<K> empty;
+  BOOST_CHECK(empty.lower_bound(1) == empty.end());
+  BOOST_CHECK(empty.upper_bound(1) == empty.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenVisitingRange_ThenOnlyKeysFromLowUpToHighAreVisitedInOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int key = 0; key < 200; key += 2)
+    map[key] = std::to_string(key);
+
+  std::vector<int> visited;
+  map.for_each_in_range(31, 50, [&visited](const typename Map<K>::value_type& item) {
+    visited.push_back(item.first);
+  });
+  BOOST_CHECK((visited == std::vector<int>{ 32, 34, 36, 38, 40, 42, 44, 46, 48 }));
+
+  map.for_each_in_range(190, 1000, [](typename Map<K>::value_type& item) {
+    item.second = "tail";
+  });
+  BOOST_CHECK_EQUAL(map.valueOf(188), "188");
+  BOOST_CHECK_EQUAL(map.valueOf(198), "tail");
+
+  std::size_t count = 0;
+  const Map<K>& constMap = map;
+  constMap.for_each_in_range(0, 200, [&count](const typename Map<K>::value_type&) { ++count; });
+  BOOST_CHECK_EQUAL(count, 100);
+  constMap.for_each_in_range(50, 50, [&count](const typename Map<K>::value_type&) { ++count; });
+  constMap.for_each_in_range(60, 40, [&count](const typename Map<K>::value_type&) { ++count; });
+  BOOST_CHECK_EQUAL(count, 100);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenAskingForRanksAndPositions_ThenTheyMatchKeyOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 100; ++i)
+    map[(i * 37) % 100 * 2] = std::to_string(i);
+  const Map<K>& constMap = map;
+
+  BOOST_CHECK_EQUAL(map.rank(0), 0);
+  BOOST_CHECK_EQUAL(map.rank(1), 1);
+  BOOST_CHECK_EQUAL(map.rank(100), 50);
+  BOOST_CHECK_EQUAL(map.rank(1000), 100);
+  BOOST_CHECK_EQUAL(map.select(0)->first, 0);
+  BOOST_CHECK_EQUAL(constMap.select(50)->first, 100);
+  BOOST_CHECK(map.select(99) == --map.end());
+  BOOST_CHECK_THROW(map.select(100), std::out_of_range);
+
+  BOOST_CHECK_EQUAL(map.count_range(10, 20), 5);
+  BOOST_CHECK_EQUAL(map.count_range(11, 20), 4);
+  BOOST_CHECK_EQUAL(map.count_range(0, 1000), 100);
+  BOOST_CHECK_EQUAL(map.count_range(20, 10), 0);
+  BOOST_CHECK_EQUAL(Map<K>().count_range(0, 10), 0);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMapChangedByInsertsAndRemovals_WhenSelectingEveryPosition_ThenRanksAgree)
+{
+  aisdi::TreeMap<int, int> map;
+  std::map<int, int> expected;
+  for (int i = 0; i < 3000; ++i)
+  {
+    int key = (i * 7919) % 1000;
+    if (i % 3 == 2 && map.contains(key))
+    {
+      map.remove(key);
+      expected.erase(key);
+    }
+    else
+    {
+      map[key] = i;
+      expected[key] = i;
+    }
+  }
+
+  BOOST_REQUIRE_EQUAL(map.getSize(), expected.size());
+  std::size_t index = 0;
+  for (const auto& item : expected)
+  {
+    BOOST_CHECK_EQUAL(map.select(index)->first, item.first);
+    BOOST_CHECK_EQUAL(map.rank(item.first), index);
+    ++index;
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSortedItems_WhenBuildingFromSorted_ThenTreeIsPerfectlyBalancedAndUsable,
+                              K,
+                              TestedKeyTypes)
+{
+  std::vector<std::pair<K, std::string>> items;
+  std::map<K, std::string> expected;
+  for (int key = 0; key < 1000; ++key)
+  {
+    items.emplace_back(key * 2, std::to_string(key));
+    expected[key * 2] = std::to_string(key);
+  }
+
+  Map<K> map = Map<K>::from_sorted(items.begin(), items.end());
+
+  /* 1000 entries fit in 10 full levels, so the height is 9 edges */
+  BOOST_CHECK_EQUAL(map.height(map.getRoot()), 9);
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_EQUAL(map.rank(1000), 500);
+  BOOST_CHECK_EQUAL(map.select(999)->first, 1998);
+
+  map[1] = "odd";
+  map.remove(0);
+  expected[1] = "odd";
+  expected.erase(0);
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE(GivenUnsortedOrDuplicateItems_WhenBuildingFromSorted_ThenItemsAreInsertedOneByOne)
+{
+  std::vector<std::pair<int, std::string>> unsorted = { { 3, "c" }, { 1, "a" }, { 2, "b" } };
+  std::vector<std::pair<int, std::string>> duplicates = { { 1, "a" }, { 1, "b" }, { 2, "c" } };
+
+  auto fromUnsorted = aisdi::TreeMap<int, std::string>::from_sorted(unsorted.begin(), unsorted.end());
+  auto fromDuplicates = aisdi::TreeMap<int, std::string>::from_sorted(duplicates.begin(), duplicates.end());
+  auto fromNothing = aisdi::TreeMap<int, std::string>::from_sorted(unsorted.begin(), unsorted.begin());
+
+  BOOST_CHECK((fromUnsorted == aisdi::TreeMap<int, std::string>{ { 1, "a" }, { 2, "b" }, { 3, "c" } }));
+  BOOST_CHECK((fromDuplicates == aisdi::TreeMap<int, std::string>{ { 1, "a" }, { 2, "c" } }));
+  BOOST_CHECK(fromNothing.isEmpty());
+  BOOST_CHECK(fromNothing.begin() == fromNothing.end());
+}
+
+BOOST_AUTO_TEST_CASE(GivenTreeBuiltByAscendingInserts_WhenCopying_ThenCopyIsPerfectlyBalanced)
+{
+  aisdi::TreeMap<int, OperationCountingObject> map;
+  for (int i = 0; i < 1023; ++i)
+    map.try_emplace(i, i);
+
+  OperationCountingObject::resetCounters();
+  aisdi::TreeMap<int, OperationCountingObject> copy(map);
+  aisdi::TreeMap<int, OperationCountingObject> assigned;
+  assigned[5000] = 1;
+  assigned = map;
+
+  BOOST_CHECK_EQUAL(OperationCountingObject::copiedObjectsCount(), 2 * 1023);
+  BOOST_CHECK_EQUAL(copy.height(copy.getRoot()), 9);
+  BOOST_CHECK_EQUAL(assigned.height(assigned.getRoot()), 9);
+  BOOST_CHECK(copy == map);
+  BOOST_CHECK(assigned == map);
+  BOOST_CHECK_EQUAL((--assigned.end())->first, 1022);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,10 +4,19 @@
 
 #include "TreeMap.h"
 #include "HashMap.h"
+#include "RobinHoodHashMap.h"
+#include "SwissHashMap.h"
+#include "BTreeMap.h"
 
 #include <iostream>
 #include <chrono>
 #include <string>
+#include <vector>
+
+#ifdef COUNT_ALLOCATIONS
+#include <new>
+#include <malloc.h>
+#endif
 
 
 using us = std::chrono::microseconds;
@@ -16,10 +25,53 @@ using size_type = std::size_t;
 using string = std::string;
 using value_type = std::pair<const int, string>;
 
+/* keeps the optimizer from dropping lookups whose result is unused */
+volatile size_type sink;
+
+/*
+  Allocation-counting build: -DCOUNT_ALLOCATIONS (glibc only) replaces the
+  global operator new / delete to keep the number of live blocks and their
+  usable bytes, so Test9 can check memory_usage() against the allocator.
+*/
+#ifdef COUNT_ALLOCATIONS
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+size_type liveBlocks = 0;
+size_type liveBytes = 0;
+
+void *operator new(size_type size)
+{
+  void *p = std::malloc(size == 0 ? 1 : size);
+  if(p == nullptr)
+    throw std::bad_alloc();
+  ++liveBlocks;
+  liveBytes += malloc_usable_size(p);
+  return p;
+}
+
+void operator delete(void *p) noexcept
+{
+  if(p == nullptr)
+    return;
+  --liveBlocks;
+  liveBytes -= malloc_usable_size(p);
+  std::free(p);
+}
 
-us testInsertHashMap( size_type number_of_elements)
+void operator delete(void *p, size_type) noexcept
 {
-  aisdi::HashMap<int, string> map(number_of_elements);
+  operator delete(p);
+}
+#endif
+
+
+/* HashMap, RobinHoodHashMap and SwissHashMap share the interface used below */
+template <typename Map>
+us testInsertHash( size_type number_of_elements)
+{
+  Map map(number_of_elements);
 
   auto start = get_time::now();
 
@@ -40,9 +92,10 @@ us testInsertTreeMap( size_type number_of_elements)
     return std::chrono::duration_cast<us>(get_time::now() - start);
 }
 
-us testRemoveHashMap( size_type number_of_elements)
+template <typename Map>
+us testRemoveHash( size_type number_of_elements)
 {
-  aisdi::HashMap<int, string> map(number_of_elements);
+  Map map(number_of_elements);
 
   for(size_type i = 0; i < number_of_elements; ++i)
   {
@@ -74,9 +127,11 @@ us testRemoveTreeMap( size_type number_of_elements)
     return std::chrono::duration_cast<us>(get_time::now() - start);
 }
 
-us testFindHashMap( size_type number_of_elements)
+/* miss == true looks up keys that were never inserted */
+template <typename Map>
+us testFindHash( size_type number_of_elements, bool miss)
 {
-    aisdi::HashMap<int, string> map(number_of_elements);
+    Map map(number_of_elements);
 
     for(size_type i = 0; i < number_of_elements; ++i)
     {
@@ -84,53 +139,524 @@ us testFindHashMap( size_type number_of_elements)
       map.insertB(data);
     }
 
+    const size_type offset = miss ? number_of_elements : 0;
     auto start = get_time::now();
 
+    size_type found = 0;
     for(size_type i = 2; i < number_of_elements / 2; i += 4)
     {
-      map.findB(i);
+      found += map.findB(i + offset) != nullptr;
     }
+    sink = found;
     return std::chrono::duration_cast<us>(get_time::now() - start);
 }
 
-us testFindTreeMap( size_type number_of_elements)
+us testFindTreeMap( size_type number_of_elements, bool miss)
 {
     aisdi::TreeMap<int, string> tree;
     tree.insertForTest(number_of_elements);
 
+    const size_type offset = miss ? number_of_elements : 0;
+    auto start = get_time::now();
+
+    size_type found = 0;
+    for(size_type i = 2; i < number_of_elements / 2; i += 4)
+    {
+      found += tree.findN(i + offset, tree.getRoot()) != nullptr;
+    }
+    sink = found;
+    return std::chrono::duration_cast<us>(get_time::now() - start);
+}
+
+/* the TreeMap tests above for BTreeMap: ascending inserts, removes of the lower half, lookups */
+us testInsertBTreeMap( size_type number_of_elements)
+{
+    aisdi::BTreeMap<int, string> tree;
+
+    auto start = get_time::now();
+    for(size_type i = 0; i < number_of_elements; ++i)
+      tree.try_emplace(i, "Item");
+    return std::chrono::duration_cast<us>(get_time::now() - start);
+}
+
+us testRemoveBTreeMap( size_type number_of_elements)
+{
+    aisdi::BTreeMap<int, string> tree;
+    for(size_type i = 0; i < number_of_elements; ++i)
+      tree.try_emplace(i, "Item");
+
+    auto start = get_time::now();
+
+    for(size_type i = 2; i < (number_of_elements / 2); ++i )
+    {
+      tree.remove(i);
+    }
+    return std::chrono::duration_cast<us>(get_time::now() - start);
+}
+
+us testFindBTreeMap( size_type number_of_elements, bool miss)
+{
+    aisdi::BTreeMap<int, string> tree;
+    for(size_type i = 0; i < number_of_elements; ++i)
+      tree.try_emplace(i, "Item");
+
+    const size_type offset = miss ? number_of_elements : 0;
     auto start = get_time::now();
 
+    size_type found = 0;
     for(size_type i = 2; i < number_of_elements / 2; i += 4)
     {
-      tree.findN(i, tree.getRoot());
+      found += tree.contains(i + offset);
     }
+    sink = found;
     return std::chrono::duration_cast<us>(get_time::now() - start);
 }
 
+/* time-window style queries: 100 windows of 50 keys, by a scan from begin() or by for_each_in_range */
+us testRangeTreeMap( size_type number_of_elements, bool ranged)
+{
+    aisdi::TreeMap<int, string> tree;
+    tree.insertForTest(number_of_elements);
+
+    const size_type windows = 100;
+    const int width = 50;
+    auto start = get_time::now();
+
+    size_type found = 0;
+    for(size_type w = 0; w < windows; ++w)
+    {
+      const int lo = (w * 7919) % number_of_elements;
+      if(ranged)
+      {
+        tree.for_each_in_range(lo, lo + width, [&found](const value_type&) { ++found; });
+      }
+      else
+      {
+        for(auto it = tree.begin(); it != tree.end(); ++it)
+          found += it->first >= lo && it->first < lo + width;
+      }
+    }
+    sink = found;
+    return std::chrono::duration_cast<us>(get_time::now() - start);
+}
+
+/* percentiles: the entries at 100 evenly spaced positions, by advancing from begin() or by select */
+us testPercentilesTreeMap( size_type number_of_elements, bool selected)
+{
+    aisdi::TreeMap<int, string> tree;
+    tree.insertForTest(number_of_elements);
+
+    auto start = get_time::now();
+
+    size_type total = 0;
+    for(size_type p = 0; p < 100; ++p)
+    {
+      const size_type index = p * number_of_elements / 100;
+      if(selected)
+      {
+        total += tree.select(index)->first;
+      }
+      else
+      {
+        auto it = tree.begin();
+        for(size_type i = 0; i < index; ++i)
+          ++it;
+        total += it->first;
+      }
+    }
+    sink = total;
+    return std::chrono::duration_cast<us>(get_time::now() - start);
+}
+
+/* counter style updates: string keys, each key is missed once and then hit three times */
+template <typename Map>
+us testSubscriptHash( size_type number_of_elements)
+{
+  Map map(number_of_elements / 4);
+  std::vector<string> keys;
+  for(size_type i = 0; i < number_of_elements; ++i)
+    keys.push_back("key" + std::to_string(i / 4));
+
+  auto start = get_time::now();
+
+  for(size_type i = 0; i < number_of_elements; ++i)
+  {
+    ++map[keys[i]];
+  }
+  return std::chrono::duration_cast<us>(get_time::now() - start);
+}
+
+/* request-sized batches of 256 keys in scattered order, one findB per key or one findMany per batch */
+template <typename Map>
+us testFindManyHash( size_type number_of_elements, bool batched)
+{
+  Map map(number_of_elements);
+  for(size_type i = 0; i < number_of_elements; ++i)
+  {
+    value_type data(i, "Item");
+    map.insertB(data);
+  }
+
+  const size_type batch = 256;
+  std::vector<int> keys;
+  for(size_type i = 0; i < number_of_elements; ++i)
+    keys.push_back(static_cast<int>(i * 2654435761u % (2 * number_of_elements)));
+  std::vector<typename Map::const_iterator> out(batch);
+
+  auto start = get_time::now();
+
+  size_type found = 0;
+  for(size_type base = 0; base + batch <= keys.size(); base += batch)
+  {
+    if(batched)
+    {
+      found += map.findMany(&keys[base], batch, out.data());
+      continue;
+    }
+    for(size_type i = 0; i < batch; ++i)
+      found += map.findB(keys[base + i]) != nullptr;
+  }
+  sink = found;
+  return std::chrono::duration_cast<us>(get_time::now() - start);
+}
+
+/* full iteration of a sparse table: one bucket in 64 is occupied */
+template <typename Map>
+us testIterateHash( size_type number_of_elements)
+{
+  Map map(number_of_elements);
+  for(size_type i = 0; i < number_of_elements / 64; ++i)
+  {
+    value_type data(i * 64, "Item");
+    map.insertB(data);
+  }
+
+  auto start = get_time::now();
+
+  size_type visited = 0;
+  for(int pass = 0; pass < 100; ++pass)
+  {
+    for(auto it = map.begin(); it != map.end(); ++it)
+      ++visited;
+  }
+  sink = visited;
+  return std::chrono::duration_cast<us>(get_time::now() - start);
+}
+
+/* expiry sweep: one pass dropping every other entry, by iterator or by collecting the keys first */
+template <typename Map>
+us testSweepHash( size_type number_of_elements, bool byIterator)
+{
+  Map map(number_of_elements);
+  for(size_type i = 0; i < number_of_elements; ++i)
+  {
+    value_type data(i, "Item");
+    map.insertB(data);
+  }
+
+  auto start = get_time::now();
+
+  if(byIterator)
+  {
+    for(auto it = map.begin(); it != map.end(); )
+    {
+      if(it->first % 2 == 0)
+        it = map.erase(it);
+      else
+        ++it;
+    }
+  }
+  else
+  {
+    std::vector<int> expired;
+    for(auto it = map.begin(); it != map.end(); ++it)
+    {
+      if(it->first % 2 == 0)
+        expired.push_back(it->first);
+    }
+    for(int key : expired)
+      map.remove(key);
+  }
+  sink = map.getSize();
+  return std::chrono::duration_cast<us>(get_time::now() - start);
+}
+
+/* snapshot of a full map through the copy constructor */
+template <typename Map>
+us testCopyHash( size_type number_of_elements)
+{
+  Map map(number_of_elements);
+  for(size_type i = 0; i < number_of_elements; ++i)
+  {
+    value_type data(i, "Item");
+    map.insertB(data);
+  }
+
+  auto start = get_time::now();
+  Map copy(map);
+  sink = copy.getSize();
+  return std::chrono::duration_cast<us>(get_time::now() - start);
+}
+
+template <typename Tree>
+us testCopyTreeMap( size_type number_of_elements)
+{
+  Tree tree;
+  tree.insertForTest(number_of_elements);
+
+  auto start = get_time::now();
+  Tree copy(tree);
+  sink = copy.getSize();
+  return std::chrono::duration_cast<us>(get_time::now() - start);
+}
+
+/* a rebuild from sorted entries: one insert per entry, or from_sorted */
+us testBuildSortedTreeMap( size_type number_of_elements, bool bulk)
+{
+  std::vector<value_type> items;
+  for(size_type i = 0; i < number_of_elements; ++i)
+    items.emplace_back(i, "Item");
+
+  auto start = get_time::now();
+  if(bulk)
+  {
+    auto tree = aisdi::TreeMap<int, string>::from_sorted(items.begin(), items.end());
+    sink = tree.getSize();
+  }
+  else
+  {
+    aisdi::TreeMap<int, string> tree;
+    for(const auto& item : items)
+      tree.insert(item);
+    sink = tree.getSize();
+  }
+  return std::chrono::duration_cast<us>(get_time::now() - start);
+}
+
+/* destroying the map frees every node; pooled maps give back whole slabs */
+template <typename Map>
+us testDestroyHash( size_type number_of_elements)
+{
+    Map *map = new Map(number_of_elements);
+
+    for(size_type i = 0; i < number_of_elements; ++i)
+    {
+      value_type data(i, "Item");
+      map->insertB(data);
+    }
+
+    auto start = get_time::now();
+    delete map;
+    return std::chrono::duration_cast<us>(get_time::now() - start);
+}
+
+template <typename Tree>
+us testDestroyTreeMap( size_type number_of_elements)
+{
+    Tree *tree = new Tree();
+    tree->insertForTest(number_of_elements);
+
+    auto start = get_time::now();
+    delete tree;
+    return std::chrono::duration_cast<us>(get_time::now() - start);
+}
+
+/* per-session style maps: many default-constructed maps holding a few entries each */
+template <typename Map>
+us testTinyMapsHash( size_type number_of_maps)
+{
+  auto start = get_time::now();
+
+  size_type total = 0;
+  for(size_type m = 0; m < number_of_maps; ++m)
+  {
+    Map map;
+    for(int i = 0; i < 4; ++i)
+    {
+      value_type data(i, "Item");
+      map.insertB(data);
+    }
+    total += map.getSize();
+  }
+  sink = total;
+  return std::chrono::duration_cast<us>(get_time::now() - start);
+}
+
+/* bytes per entry from memory_usage(); the counting build also shows what the allocator handed out */
+template <typename Map, typename Fill>
+void reportMemory(const char* name, size_type number_of_elements, Fill fill)
+{
+#ifdef COUNT_ALLOCATIONS
+  size_type blocks = liveBlocks;
+  size_type bytes = liveBytes;
+#endif
+  {
+    Map map;
+    fill(map, number_of_elements);
+    aisdi::MemoryUsage m = map.memory_usage();
+    std::cout << name << ": " << m.total() << " B, "
+              << static_cast<double>(m.total()) / number_of_elements << " B/entry"
+              << " (buckets " << m.bucketBytes << ", nodes " << m.nodeBytes
+              << ", overhead " << m.overheadBytes << ", payload " << m.payloadBytes << ")\n";
+#ifdef COUNT_ALLOCATIONS
+    /* usable size plus the 8-byte chunk header is what a glibc block costs */
+    size_type counted = m.objectBytes + (liveBytes - bytes) + 8 * (liveBlocks - blocks);
+    std::cout << "  allocator: " << counted << " B in " << liveBlocks - blocks << " blocks\n";
+#endif
+  }
+}
+
+template <typename Map>
+void fillHash(Map& map, size_type number_of_elements)
+{
+  for(size_type i = 0; i < number_of_elements; ++i)
+  {
+    value_type data(i, "Item");
+    map.insertB(data);
+  }
+}
+
+template <typename Tree>
+void fillTree(Tree& tree, size_type number_of_elements)
+{
+  tree.insertForTest(number_of_elements);
+}
+
+template <typename Tree>
+void fillBTree(Tree& tree, size_type number_of_elements)
+{
+  for(size_type i = 0; i < number_of_elements; ++i)
+    tree.try_emplace(i, "Item");
+}
+
+void report(const char* name, us time)
+{
+  std::cout << name << ": " << time.count() << " us\n";
+}
+
 int main(int argc, char** argv)
 {
   const size_type repeatCount = argc > 1 ? std::atoll(argv[1]) : 60000;
 
+  using Chained = aisdi::HashMap<int, string>;
+  using ChainedMix = aisdi::HashMap<int, string, aisdi::MixHash<int>>;
+  using RobinHood = aisdi::RobinHoodHashMap<int, string>;
+  using Swiss = aisdi::SwissHashMap<int, string>;
+  using ChainedPooled = aisdi::HashMap<int, string, std::hash<int>, std::equal_to<int>, aisdi::PooledNodes<>>;
+  using Tree = aisdi::TreeMap<int, string>;
+  using TreePooled = aisdi::TreeMap<int, string, std::less<int>, aisdi::PooledNodes<>>;
+  using BTree = aisdi::BTreeMap<int, string>;
+
   std::cout << "Test1: Inserting elements\n";
-  auto diff = testInsertHashMap( repeatCount );
-  std::cout << "HashMap: " << std::chrono::duration_cast<us>(diff).count()<< " us\n";
+  auto diff = testInsertHash<Chained>( repeatCount );
+  report("HashMap", diff);
+  report("HashMap (MixHash)", testInsertHash<ChainedMix>( repeatCount ));
+  report("HashMap (pooled)", testInsertHash<ChainedPooled>( repeatCount ));
+  report("RobinHood", testInsertHash<RobinHood>( repeatCount ));
+  report("Swiss", testInsertHash<Swiss>( repeatCount ));
   auto diff2 = testInsertTreeMap( repeatCount );
-  std::cout << "TreeMap: " << std::chrono::duration_cast<us>(diff2).count() << " us\n";
+  report("TreeMap", diff2);
+  report("BTreeMap", testInsertBTreeMap( repeatCount ));
   std::cout << "Difference: " << std::chrono::duration_cast<us>(diff2-diff).count() << " us\n\n";
 
   std::cout << "Test2: Removing elements\n";
-  diff = testRemoveHashMap( repeatCount );
-  std::cout << "HashMap: " << std::chrono::duration_cast<us>(diff).count()<< " us\n";
+  diff = testRemoveHash<Chained>( repeatCount );
+  report("HashMap", diff);
+  report("HashMap (MixHash)", testRemoveHash<ChainedMix>( repeatCount ));
+  report("RobinHood", testRemoveHash<RobinHood>( repeatCount ));
+  report("Swiss", testRemoveHash<Swiss>( repeatCount ));
   diff2 = testRemoveTreeMap( repeatCount );
-  std::cout << "TreeMap: " << std::chrono::duration_cast<us>(diff2).count() << " us\n";
+  report("TreeMap", diff2);
+  report("BTreeMap", testRemoveBTreeMap( repeatCount ));
   std::cout << "Difference: " << std::chrono::duration_cast<us>(diff2-diff).count() << " us\n\n";
 
-  std::cout << "Test1: Finding elements\n";
-  diff = testFindHashMap( repeatCount );
-  std::cout << "HashMap: " << std::chrono::duration_cast<us>(diff).count()<< " us\n";
-  diff2 = testFindTreeMap( repeatCount );
-  std::cout << "TreeMap: " << std::chrono::duration_cast<us>(diff2).count() << " us\n";
+  std::cout << "Test3: Finding elements (hit)\n";
+  diff = testFindHash<Chained>( repeatCount, false );
+  report("HashMap", diff);
+  report("HashMap (MixHash)", testFindHash<ChainedMix>( repeatCount, false ));
+  report("RobinHood", testFindHash<RobinHood>( repeatCount, false ));
+  report("Swiss", testFindHash<Swiss>( repeatCount, false ));
+  diff2 = testFindTreeMap( repeatCount, false );
+  report("TreeMap", diff2);
+  report("BTreeMap", testFindBTreeMap( repeatCount, false ));
   std::cout << "Difference: " << std::chrono::duration_cast<us>(diff2-diff).count() << " us\n\n";
 
+  std::cout << "Test4: Finding elements (miss)\n";
+  diff = testFindHash<Chained>( repeatCount, true );
+  report("HashMap", diff);
+  report("HashMap (MixHash)", testFindHash<ChainedMix>( repeatCount, true ));
+  report("RobinHood", testFindHash<RobinHood>( repeatCount, true ));
+  report("Swiss", testFindHash<Swiss>( repeatCount, true ));
+  diff2 = testFindTreeMap( repeatCount, true );
+  report("TreeMap", diff2);
+  report("BTreeMap", testFindBTreeMap( repeatCount, true ));
+  std::cout << "Difference: " << std::chrono::duration_cast<us>(diff2-diff).count() << " us\n\n";
+
+  std::cout << "Test5: Destroying map\n";
+  diff = testDestroyHash<Chained>( repeatCount );
+  report("HashMap", diff);
+  report("HashMap (pooled)", testDestroyHash<ChainedPooled>( repeatCount ));
+  diff2 = testDestroyTreeMap<Tree>( repeatCount );
+  report("TreeMap", diff2);
+  report("TreeMap (pooled)", testDestroyTreeMap<TreePooled>( repeatCount ));
+  std::cout << "Difference: " << std::chrono::duration_cast<us>(diff2-diff).count() << " us\n\n";
+
+  std::cout << "Test6: Updating through operator[]\n";
+  report("HashMap", testSubscriptHash<aisdi::HashMap<string, size_type>>( repeatCount ));
+  report("RobinHood", testSubscriptHash<aisdi::RobinHoodHashMap<string, size_type>>( repeatCount ));
+  report("Swiss", testSubscriptHash<aisdi::SwissHashMap<string, size_type>>( repeatCount ));
+  std::cout << "\n";
+
+  std::cout << "Test7: Iterating a sparse map (100 passes)\n";
+  report("HashMap", testIterateHash<Chained>( repeatCount ));
+  report("RobinHood", testIterateHash<RobinHood>( repeatCount ));
+  report("Swiss", testIterateHash<Swiss>( repeatCount ));
+  std::cout << "\n";
+
+  std::cout << "Test8: Finding batches of 256 keys\n";
+  report("HashMap (findB loop)", testFindManyHash<Chained>( repeatCount * 16, false ));
+  report("HashMap (findMany)", testFindManyHash<Chained>( repeatCount * 16, true ));
+  std::cout << "\n";
+
+  std::cout << "Test9: Memory usage\n";
+  reportMemory<Chained>("HashMap", repeatCount, fillHash<Chained>);
+  reportMemory<ChainedPooled>("HashMap (pooled)", repeatCount, fillHash<ChainedPooled>);
+  reportMemory<Tree>("TreeMap", repeatCount, fillTree<Tree>);
+  reportMemory<TreePooled>("TreeMap (pooled)", repeatCount, fillTree<TreePooled>);
+  reportMemory<BTree>("BTreeMap", repeatCount, fillBTree<BTree>);
+  std::cout << "\n";
+
+  std::cout << "Test10: Building maps of 4 entries\n";
+  report("HashMap", testTinyMapsHash<Chained>( repeatCount ));
+  report("HashMap (pooled)", testTinyMapsHash<ChainedPooled>( repeatCount ));
+  std::cout << "\n";
+
+  std::cout << "Test11: Sweeping out every other entry\n";
+  report("HashMap (remove by key)", testSweepHash<Chained>( repeatCount, false ));
+  report("HashMap (erase by iterator)", testSweepHash<Chained>( repeatCount, true ));
+  std::cout << "\n";
+
+  std::cout << "Test12: Copying a map\n";
+  report("HashMap", testCopyHash<Chained>( repeatCount ));
+  report("HashMap (pooled)", testCopyHash<ChainedPooled>( repeatCount ));
+  report("TreeMap", testCopyTreeMap<Tree>( repeatCount ));
+  report("TreeMap (pooled)", testCopyTreeMap<TreePooled>( repeatCount ));
+  std::cout << "\n";
+
+  std::cout << "Test13: Visiting 100 key ranges of 50\n";
+  report("TreeMap (scan from begin)", testRangeTreeMap( repeatCount, false ));
+  report("TreeMap (for_each_in_range)", testRangeTreeMap( repeatCount, true ));
+  std::cout << "\n";
+
+  std::cout << "Test14: Finding 100 percentiles\n";
+  report("TreeMap (advance from begin)", testPercentilesTreeMap( repeatCount, false ));
+  report("TreeMap (select)", testPercentilesTreeMap( repeatCount, true ));
+  std::cout << "\n";
+
+  std::cout << "Test15: Building a map from sorted entries\n";
+  report("TreeMap (insert)", testBuildSortedTreeMap( repeatCount, false ));
+  report("TreeMap (from_sorted)", testBuildSortedTreeMap( repeatCount, true ));
+  std::cout << "\n";
+
   return 0;
 }